@@ -1,19 +1,26 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <list>
 #include <thread>
-#include <mutex>
+#include <atomic>
 #include <memory>
 #include <functional>
 
 #include <Event.hpp>
 #include <Timer.hpp>
+#include <DateTime.hpp>
 #include <Duration.hpp>
 #include <Function.hpp>
 #include <TimeWheel.hpp>
 #include <ePoll.hpp>
+#include <uRing.hpp>
+#include <Iterable/List.hpp>
 #include <Iterable/Queue.hpp>
+#include <Iterable/MPSCQueue.hpp>
+#include <Iterable/PoolAllocator.hpp>
 #include <Network/Socket.hpp>
 #include <Network/HTTP/Response.hpp>
 #include <Network/HTTP/Request.hpp>
@@ -29,10 +36,30 @@ namespace Core::Async
         struct Entry;
         struct Context;
 
+        // Build with CORE_IO_URING defined to poll through io_uring instead of epoll, I/O itself stays readiness based
+
+#ifdef CORE_IO_URING
+        using PollType = uRing;
+#else
+        using PollType = ePoll;
+#endif
+
         using TimeWheelType = TimeWheel<32, 5>;
-        using Container = std::list<Entry>;
-        using CallbackType = Core::Function<void(EventLoop::Context &, ePoll::Entry &)>;
-        using EndCallbackType = Core::Function<void()>;
+        using Container = std::list<Entry, Iterable::PoolAllocator<Entry>>;
+        using CallbackType = Core::UniqueFunction<void(EventLoop::Context &, ePoll::Entry &), 32>;
+        using EndCallbackType = Core::UniqueFunction<void(), 32>;
+        using ActionType = Core::UniqueFunction<void(), 192>;
+
+        struct Assignment
+        {
+            Descriptor File;
+            CallbackType Callback;
+            EndCallbackType End;
+            Duration Timeout;
+            ePoll::Event Events = ePoll::In;
+        };
+
+        using AssignmentList = Iterable::List<Assignment>;
 
         struct Entry
         {
@@ -42,6 +69,11 @@ namespace Core::Async
             Container::iterator Iterator;
             TimeWheelType::Bucket::Iterator Timer;
 
+            // Idle timeout bookkeeping in wheel ticks
+
+            size_t Active = 0;
+            size_t Idle = 0;
+
             template <typename T>
             inline T *CallbackAs()
             {
@@ -94,6 +126,15 @@ namespace Core::Async
                 return Loop.Schedule(Timeout, std::forward<TCallback>(Callback));
             }
 
+            /**
+             * @brief Marks the entry as active so its idle timeout
+             * starts over, without touching the time wheel
+             */
+            inline void Touch()
+            {
+                Loop.Touch(Self);
+            }
+
             inline void Reschedule(Duration const &Timeout)
             {
                 Loop.Reschedule(Self, Timeout);
@@ -118,9 +159,12 @@ namespace Core::Async
 
         EventLoop() = default;
         EventLoop(EventLoop const &Other) = delete;
-        EventLoop(EventLoop &&Other) noexcept : _Poll(std::move(Other._Poll)), Expire(std::move(Other.Expire)), Interrupt(std::move(Other.Interrupt)), Wheel(std::move(Other.Wheel)), Handlers(std::move(Other.Handlers)), Actions(std::move(Other.Actions)) {}
+        EventLoop(EventLoop &&Other) noexcept : _Poll(std::move(Other._Poll)), Expire(std::move(Other.Expire)), Alarm(std::move(Other.Alarm)), Interrupt(std::move(Other.Interrupt)), Wheel(std::move(Other.Wheel)), Handlers(std::move(Other.Handlers)), Actions(std::move(Other.Actions)), DateSecond(Other.DateSecond)
+        {
+            std::memcpy(DateText, Other.DateText, sizeof(DateText));
+        }
 
-        EventLoop(Duration const &Interval) : _Poll(0), Expire(nullptr), Interrupt(nullptr), Wheel(Interval)
+        EventLoop(Duration const &Interval) : _Poll(0), Expire(nullptr), Alarm(nullptr), Interrupt(nullptr), Wheel(Interval)
         {
             auto IIterator = Insert(
                 Event(0, 0),
@@ -130,19 +174,16 @@ namespace Core::Async
 
                     ev.Listen();
 
-                    {
-                        // @todo Potential bottle neck
-
-                        std::unique_lock lock(Context.Loop.QueueMutex);
+                    // Re-arm notification before draining so producers that
+                    // missed this round will emit again
 
-                        Context.Loop.Actions.ForEach(
-                            [](auto &CB)
-                            {
-                                CB();
-                            });
+                    Context.Loop.Pending.exchange(false, std::memory_order_acq_rel);
 
-                        Context.Loop.Actions.Free();
-                    }
+                    Context.Loop.Actions.Consume(
+                        [](auto &CB)
+                        {
+                            CB();
+                        });
                 },
                 nullptr,
                 {0, 0});
@@ -157,10 +198,12 @@ namespace Core::Async
                 Timer(Timer::Monotonic, 0),
                 [](EventLoop::Context &Context, ePoll::Entry &)
                 {
-                    auto &Ev = *static_cast<Event *>(&Context.Self.File);
+                    auto &Ev = *static_cast<Timer *>(&Context.Self.File);
 
-                    Ev.Listen();
-                    Context.Loop.Wheel.Tick();
+                    // Expirations missed while the loop was busy are all processed
+
+                    Context.Loop.Wheel.Tick(Ev.Listen());
+                    Context.Loop.RefreshDate();
                 },
                 nullptr,
                 {0, 0});
@@ -168,6 +211,49 @@ namespace Core::Async
             // Assign expire event
 
             Expire = static_cast<Timer *>(&TIterator->File);
+
+            // Add alarm event for timers due before the next tick
+
+            auto AIterator = Insert(
+                Timer(Timer::Monotonic, 0),
+                [](EventLoop::Context &Context, ePoll::Entry &)
+                {
+                    auto &Ev = *static_cast<Timer *>(&Context.Self.File);
+
+                    Ev.Listen();
+
+                    Context.Loop.Armed = 0;
+                    Context.Loop.Wheel.Advance();
+                },
+                nullptr,
+                {0, 0});
+
+            Alarm = static_cast<Timer *>(&AIterator->File);
+
+            RefreshDate();
+        }
+
+        /**
+         * @brief Current time formatted for the HTTP date header
+         * Refreshed by the expire tick at most once per second, so it is as
+         * fresh as the tick interval allows and never formatted per response
+         */
+        inline std::string_view Date() const
+        {
+            return {DateText, DateTime::IMFLength};
+        }
+
+        void RefreshDate()
+        {
+            struct timespec Now;
+
+            clock_gettime(CLOCK_REALTIME_COARSE, &Now);
+
+            if (Now.tv_sec == DateSecond)
+                return;
+
+            DateSecond = Now.tv_sec;
+            DateTime::FormatIMF(Now.tv_sec, DateText);
         }
 
         inline bool HasPermission() const
@@ -193,18 +279,21 @@ namespace Core::Async
         {
             AssertPermission();
 
-            auto Callback = std::move(Iterator->Callback);
-
-            Wheel.Remove(Iterator);
-
-            return Wheel.Add(Interval, std::move(Callback));
+            return Wheel.Reschedule(Iterator, Interval);
         }
 
         void Reschedule(Entry &Self, Duration const &Interval)
         {
+            Self.Active = Wheel.Now();
+            Self.Idle = Wheel.StepsOf(Interval);
             Self.Timer = Reschedule(Self.Timer, Interval);
         }
 
+        inline void Touch(Entry &Self)
+        {
+            Self.Active = Wheel.Now();
+        }
+
         /**
          * @brief Only removes the connection handler
          * @param Iterator
@@ -243,15 +332,9 @@ namespace Core::Async
         template <typename TCallback>
         void Enqueue(TCallback &&Callback)
         {
-            {
-                using namespace std::placeholders;
+            Actions.Add(std::forward<TCallback>(Callback));
 
-                std::unique_lock lock(QueueMutex);
-
-                Actions.Add(std::forward<TCallback>(Callback));
-            }
-
-            Notify();
+            Wake();
         }
 
         template <typename TCallback, typename... TArgs>
@@ -263,21 +346,13 @@ namespace Core::Async
             }
             else
             {
-                // @todo maybe use lock free queue?
-
-                {
-                    using namespace std::placeholders;
-
-                    std::unique_lock lock(QueueMutex);
-
-                    Actions.Add(
-                        [Callback = std::forward<TCallback>(Callback), ... Args = std::forward<TArgs>(Args)]() mutable
-                        {
-                            Callback(std::forward<TArgs>(Args)...);
-                        });
-                }
+                Actions.Add(
+                    [Callback = std::forward<TCallback>(Callback), ... Args = std::forward<TArgs>(Args)]() mutable
+                    {
+                        Callback(std::forward<TArgs>(Args)...);
+                    });
 
-                Notify();
+                Wake();
             }
         }
 
@@ -291,6 +366,23 @@ namespace Core::Async
                 std::move(Client), std::move(Callback), std::move(End), Interval);
         }
 
+        /**
+         * @brief Hands a whole batch of descriptors to this loop in a single enqueue
+         */
+        void Assign(AssignmentList &&Batch)
+        {
+            Execute(
+                [this](AssignmentList &&Items) mutable
+                {
+                    Items.ForEach(
+                        [this](Assignment &Item)
+                        {
+                            Insert(std::move(Item.File), std::move(Item.Callback), std::move(Item.End), Item.Timeout, Item.Events);
+                        });
+                },
+                std::move(Batch));
+        }
+
         void Upgrade(Entry &Self, CallbackType &&Callback, Duration const &Interval = {0, 0}, ePoll::Event Events = ePoll::In)
         {
             Execute(
@@ -306,17 +398,30 @@ namespace Core::Async
             Interrupt->Emit(Value);
         }
 
+        /**
+         * @brief Coalesced Notify, only the first enqueue after
+         * the loop drains its actions writes to the eventfd
+         */
+        inline void Wake()
+        {
+            if (!Pending.exchange(true, std::memory_order_acq_rel))
+                Notify();
+        }
+
         template <typename TCallback>
         void Loop(TCallback Condition)
         {
             auto duration = Wheel.Interval();
 
+            Wheel.Start();
             Expire->Set(duration, duration);
 
             ePoll::List Events(Handlers.size() ? Handlers.size() : 1);
 
             while (Condition())
             {
+                Arm();
+
                 _Poll(Events);
 
                 Events.ForEach(
@@ -338,51 +443,86 @@ namespace Core::Async
             {
                 _Poll = std::move(Other._Poll);
                 Expire = std::move(Other.Expire);
+                Alarm = std::move(Other.Alarm);
                 Interrupt = std::move(Other.Interrupt);
                 Wheel = std::move(Other.Wheel);
                 Handlers = std::move(Other.Handlers);
                 Actions = std::move(Other.Actions);
+                DateSecond = Other.DateSecond;
+
+                std::memcpy(DateText, Other.DateText, sizeof(DateText));
             }
 
             return *this;
         }
 
     private:
+        /**
+         * @brief Points the alarm at the earliest timer due before the next tick
+         * Only changes of that deadline cost a syscall
+         */
+        void Arm()
+        {
+            auto Nearest = Wheel.Nearest();
+
+            if (!Nearest || Nearest == Armed)
+                return;
+
+            Armed = Nearest;
+            Alarm->SetAt(Duration(static_cast<time_t>(Nearest / 1000000000), static_cast<time_t>(Nearest % 1000000000)));
+        }
+
+        void Watch(Container::iterator Iterator, Duration const &Timeout)
+        {
+            if (Timeout.AsMilliseconds() <= 0)
+            {
+                Iterator->Timer = Wheel.end();
+                return;
+            }
+
+            Iterator->Active = Wheel.Now();
+            Iterator->Idle = Wheel.StepsOf(Timeout);
+
+            Iterator->Timer = Wheel.Add(
+                Timeout,
+                [this, Iterator]
+                {
+                    // Timeouts are lazy, an entry that was touched since its timer was
+                    // armed gets the rest of its time instead of being removed
+
+                    size_t Elapsed = Wheel.Now() - Iterator->Active;
+
+                    if (Elapsed < Iterator->Idle)
+                    {
+                        Wheel.Reschedule(Iterator->Timer, Iterator->Idle - Elapsed);
+                        return;
+                    }
+
+                    /**
+                     * @brief Important note
+                     * Remove cannot be used here
+                     * because this function is called on time out
+                     * event in which an iterator will loop through
+                     * the list's entries and clean it.
+                     * Calling normal Remove will cause the iterator itself
+                     * to be removed in between iterating through that list
+                     * and will cause segmentation fault.
+                     * RemoveHandler in turn, will only remove the descriptor
+                     * and its handler but not the time-out entry inside our
+                     * time wheel object so after executing this callback,
+                     * the time wheel handles the task of cleaning the time-out
+                     * handler and iterator itself.
+                     */
+                    RemoveHandler(Iterator);
+                });
+        }
+
         Container::iterator Insert(Descriptor &&descriptor, CallbackType &&handler, EndCallbackType &&end, Duration const &Timeout, ePoll::Event Events = ePoll::In)
         {
             auto Iterator = Handlers.insert(Handlers.end(), {std::move(descriptor), std::move(handler), std::move(end), Handlers.end(), Wheel.end()});
             Iterator->Iterator = Iterator;
 
-            if (Timeout.AsMilliseconds() > 0)
-            {
-                Iterator->Timer = Wheel.Add(
-                    Timeout,
-                    [this, Iterator]
-                    {
-                        // Remove(Iterator);
-
-                        /**
-                         * @brief Important note
-                         * Remove cannot be used here
-                         * because this function is called on time out
-                         * event in which an iterator will loop through
-                         * the list's entries and clean it.
-                         * Calling normal Remove will cause the iterator itself
-                         * to be removed in between iterating through that list
-                         * and will cause segmentation fault.
-                         * RemoveHandler in turn, will only remove the descriptor
-                         * and its handler but not the time-out entry inside our
-                         * time wheel object so after executing this callback,
-                         * the time wheel handles the task of cleaning the time-out
-                         * handler and iterator itself.
-                         */
-                        RemoveHandler(Iterator);
-                    });
-            }
-            else
-            {
-                Iterator->Timer = Wheel.At(0, 0).Entries.end();
-            }
+            Watch(Iterator, Timeout);
 
             _Poll.Add(Iterator->File, Events, (size_t) & *Iterator);
 
@@ -394,19 +534,7 @@ namespace Core::Async
             auto Iterator = Handlers.insert(Handlers.end(), {std::move(Item->File), std::move(handler), std::move(Item->End), Handlers.end(), Wheel.end()});
             Iterator->Iterator = Iterator;
 
-            if (Timeout.AsMilliseconds() > 0)
-            {
-                Iterator->Timer = Wheel.Add(
-                    Timeout,
-                    [this, Iterator]
-                    {
-                        RemoveHandler(Iterator);
-                    });
-            }
-            else
-            {
-                Iterator->Timer = Wheel.At(0, 0).Entries.end();
-            }
+            Watch(Iterator, Timeout);
 
             _Poll.Modify(Iterator->File, Events, (size_t) & *Iterator);
 
@@ -416,14 +544,21 @@ namespace Core::Async
             return Iterator;
         }
 
-        ePoll _Poll;
+        PollType _Poll;
         Timer *Expire;
+        Timer *Alarm;
+        uint64_t Armed = 0;
         Event *Interrupt;
         TimeWheelType Wheel;
         Container Handlers;
 
-        std::mutex QueueMutex;
-        Iterable::Queue<Core::Function<void()>> Actions;
+        Iterable::MPSCQueue<ActionType> Actions;
+        std::atomic_bool Pending{false};
+
+        // Cached date header value and the second it was formatted for
+
+        time_t DateSecond = -1;
+        char DateText[DateTime::IMFLength] = {};
 
     public:
         std::thread Runner;
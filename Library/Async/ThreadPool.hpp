@@ -5,12 +5,16 @@
 #include <future>
 #include <atomic>
 #include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <system_error>
 
 #include <Event.hpp>
 #include <Duration.hpp>
 #include <TimeWheel.hpp>
 #include <ePoll.hpp>
 #include <Iterable/Span.hpp>
+#include <Iterable/List.hpp>
 #include <Network/Socket.hpp>
 #include <Network/HTTP/Response.hpp>
 #include <Network/HTTP/Request.hpp>
@@ -40,6 +44,11 @@ namespace Core::Async
         template <typename TCallback>
         void Run(TCallback &&Condition)
         {
+            // Cpus are taken from the ones this process may run on, read before any thread exists
+
+            if (PinThreads)
+                CPUs = AllowedCPUs();
+
             for (size_t i = 0; i < Loops.Length() - 1; ++i)
             {
                 auto &Loop = Loops[i];
@@ -55,6 +64,9 @@ namespace Core::Async
                     });
 
                 Loop.RunnerId = Loop.Runner.get_id();
+
+                if (PinThreads && !PinError)
+                    PinError = Pin(Loop.Runner.native_handle(), i);
             }
 
             SignalGo();
@@ -65,6 +77,11 @@ namespace Core::Async
         {
             HasJoined.store(true);
 
+            // The joining thread runs the last loop, it is pinned like the others
+
+            if (PinThreads && !PinError)
+                PinError = Pin(pthread_self(), Loops.Length() - 1);
+
             AwaitGo();
 
             Loops.Last().Loop(std::forward<TCallback>(Condition));
@@ -88,6 +105,56 @@ namespace Core::Async
             return HasJoined.load(std::memory_order_relaxed) ? Loops.Length() : Loops.Length() - 1;
         }
 
+        // Loops including the one a thread joins with GetInPool
+
+        inline size_t LoopCount() const
+        {
+            return Loops.Length();
+        }
+
+        /**
+         * @brief Pins loop i to the i-th cpu (modulo cpu count) this process may run on once the pool runs
+         */
+        inline void Affinity(bool Enable)
+        {
+            PinThreads = Enable;
+        }
+
+        /**
+         * @brief Error of the first loop that could not be pinned, the loops from there on are left unpinned
+         * Pinning fails after the threads started so it is reported here instead of thrown
+         */
+        inline std::error_code AffinityError() const
+        {
+            return PinError;
+        }
+
+        /**
+         * @brief Cpus this process may run on in ascending order, loop i is pinned to
+         * entry i modulo their count
+         */
+        static Iterable::List<int> AllowedCPUs()
+        {
+            cpu_set_t Allowed;
+
+            CPU_ZERO(&Allowed);
+
+            if (sched_getaffinity(0, sizeof(Allowed), &Allowed) != 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            Iterable::List<int> Result(CPU_COUNT(&Allowed));
+
+            for (int CPU = 0; CPU < CPU_SETSIZE; CPU++)
+            {
+                if (CPU_ISSET(CPU, &Allowed))
+                    Result.Add(CPU);
+            }
+
+            return Result;
+        }
+
         inline EventLoop &operator[](size_t Index)
         {
             return Loops[Index];
@@ -106,10 +173,26 @@ namespace Core::Async
         Iterable::Span<EventLoop> Loops;
         Duration Interval;
         std::atomic_bool HasJoined{false};
+        bool PinThreads = false;
+        std::error_code PinError;
+        Iterable::List<int> CPUs;
 
         std::promise<void> GoPromise;
         std::shared_future<void> GoFuture{GoPromise.get_future()};
 
+        std::error_code Pin(pthread_t Thread, size_t Index) const
+        {
+            if (!CPUs.Length())
+                return std::make_error_code(std::errc::invalid_argument);
+
+            cpu_set_t Set;
+
+            CPU_ZERO(&Set);
+            CPU_SET(CPUs[Index % CPUs.Length()], &Set);
+
+            return std::error_code(pthread_setaffinity_np(Thread, sizeof(Set), &Set), std::generic_category());
+        }
+
         void SignalGo()
         {
             GoPromise.set_value();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstring>
 #include <time.h>
 
 #include <Duration.hpp>
@@ -251,6 +252,48 @@ namespace Core
             return DateTime(rawtime);
         }
 
+        /**
+         * @brief Formats a time as an RFC 7231 IMF-fixdate such as "Sun, 06 Nov 1994 08:49:37 GMT"
+         * Names are not taken from the locale so the result is always valid in HTTP headers
+         * @param Buffer Receives IMFLength characters, no null terminator is written
+         */
+        static void FormatIMF(time_t Seconds, char *Buffer)
+        {
+            static constexpr char Days[] = "SunMonTueWedThuFriSat";
+            static constexpr char Names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+            struct tm Time;
+
+            gmtime_r(&Seconds, &Time);
+
+            auto Two = [](char *Out, int Value)
+            {
+                Out[0] = static_cast<char>('0' + Value / 10);
+                Out[1] = static_cast<char>('0' + Value % 10);
+            };
+
+            int Year = Time.tm_year + 1900;
+
+            std::memcpy(Buffer, Days + Time.tm_wday * 3, 3);
+            Buffer[3] = ',';
+            Buffer[4] = ' ';
+            Two(Buffer + 5, Time.tm_mday);
+            Buffer[7] = ' ';
+            std::memcpy(Buffer + 8, Names + Time.tm_mon * 3, 3);
+            Buffer[11] = ' ';
+            Two(Buffer + 12, Year / 100);
+            Two(Buffer + 14, Year % 100);
+            Buffer[16] = ' ';
+            Two(Buffer + 17, Time.tm_hour);
+            Buffer[19] = ':';
+            Two(Buffer + 20, Time.tm_min);
+            Buffer[22] = ':';
+            Two(Buffer + 23, Time.tm_sec);
+            std::memcpy(Buffer + 25, " GMT", 4);
+        }
+
+        static constexpr size_t IMFLength = 29;
+
         static DateTime FromNow(time_t Seconds, time_t Nanoseconds = 0)
         {
             auto Result = Now();
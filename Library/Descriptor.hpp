@@ -13,6 +13,7 @@
 #include <algorithm>
 
 #include <Iterable/Span.hpp>
+#include <Iterable/Buffer.hpp>
 #include <Format/Stream.hpp>
 
 namespace Core
@@ -79,7 +80,12 @@ namespace Core
 
             if (Result < 0)
             {
-                throw std::system_error(errno, std::generic_category());
+                auto EB = errno;
+
+                if (EB == EAGAIN)
+                    return 0;
+
+                throw std::system_error(EB, std::generic_category());
             }
 
             return Result;
@@ -350,13 +356,57 @@ namespace Core
             return Result;
         }
 
+        /**
+         * @brief Reads into the stream's free space
+         * @return Read bytes, 0 if it would block or -1 at end of stream
+         */
         ssize_t Read(Format::Stream &Stream)
         {
             struct iovec Vectors[2];
-            ssize_t Result = Read(Vectors, Stream.Queue.EmptyVectors(Vectors));
+            ssize_t Result = readv(_INode, Vectors, Stream.Queue.EmptyVectors(Vectors));
 
-            if (Result > 0)
-                Stream.Queue.AdvanceTail(Result);
+            if (Result < 0)
+            {
+                auto EB = errno;
+
+                if (EB == EAGAIN)
+                    return 0;
+
+                throw std::system_error(EB, std::generic_category());
+            }
+
+            if (Result == 0)
+                return -1;
+
+            Stream.Queue.AdvanceTail(Result);
+
+            return Result;
+        }
+
+        /**
+         * @brief Reads into the room after the buffer's tail
+         * @return Read bytes, 0 if it would block or -1 at end of stream
+         */
+        ssize_t Read(Iterable::Buffer<char> &Input)
+        {
+            auto [Pointer, Size] = Input.EmptyChunk();
+
+            ssize_t Result = read(_INode, Pointer, Size);
+
+            if (Result < 0)
+            {
+                auto EB = errno;
+
+                if (EB == EAGAIN)
+                    return 0;
+
+                throw std::system_error(EB, std::generic_category());
+            }
+
+            if (Result == 0)
+                return -1;
+
+            Input.AdvanceTail(Result);
 
             return Result;
         }
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string_view>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace Core::Format
+{
+    /**
+     * @brief Gzip encoder and decoder over zlib, link with -lz
+     * Setting up a zlib stream allocates its window and state, streams here are
+     * reset between uses instead so a warmed up stream allocates nothing.
+     */
+    class GZip
+    {
+    public:
+        enum class Modes
+        {
+            Deflate,
+            Inflate
+        };
+
+        GZip(Modes mode, int level = Z_DEFAULT_COMPRESSION) : Mode(mode), Level(level)
+        {
+            // Window bits over 15 select the gzip wrapper
+
+            int Result = Mode == Modes::Deflate ? deflateInit2(&Stream, Level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) : inflateInit2(&Stream, 15 + 16);
+
+            if (Result != Z_OK)
+                throw std::runtime_error("Failed to set up zlib stream");
+        }
+
+        GZip(GZip const &Other) = delete;
+        GZip &operator=(GZip const &Other) = delete;
+
+        ~GZip()
+        {
+            if (Mode == Modes::Deflate)
+                deflateEnd(&Stream);
+            else
+                inflateEnd(&Stream);
+        }
+
+        /**
+         * @brief Encodes or decodes all of Input and appends the result to Output
+         * Output is any buffer with IncreaseCapacity(), EmptyChunk() and AdvanceTail()
+         * @param Limit Largest size of the result or 0 for no limit
+         * @throw std::invalid_argument on malformed or truncated input and
+         * std::length_error once the result passes the limit
+         */
+        template <typename TOutput>
+        void Run(std::string_view Input, TOutput &Output, size_t Limit = 0)
+        {
+            Reset();
+
+            Stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(Input.data()));
+            Stream.avail_in = Input.length();
+
+            size_t Produced = 0;
+            int Result = Z_OK;
+
+            do
+            {
+                Output.IncreaseCapacity(Chunk);
+
+                auto [Pointer, Size] = Output.EmptyChunk();
+
+                Stream.next_out = reinterpret_cast<Bytef *>(Pointer);
+                Stream.avail_out = Size;
+
+                Result = Mode == Modes::Deflate ? deflate(&Stream, Z_FINISH) : inflate(&Stream, Z_NO_FLUSH);
+
+                Output.AdvanceTail(Size - Stream.avail_out);
+                Produced += Size - Stream.avail_out;
+
+                if (Limit && Produced > Limit)
+                    throw std::length_error("Result is over the limit");
+
+                // No progress with room left means the input ended early
+
+                if (Result == Z_BUF_ERROR && Stream.avail_out)
+                    throw std::invalid_argument("Truncated gzip data");
+
+                if (Result != Z_OK && Result != Z_STREAM_END && Result != Z_BUF_ERROR)
+                    throw std::invalid_argument("Invalid gzip data");
+
+            } while (Result != Z_STREAM_END);
+        }
+
+        /**
+         * @brief Streams of this thread, so there is one of each per event loop
+         */
+        static GZip &Deflater(int Level = Z_DEFAULT_COMPRESSION)
+        {
+            thread_local GZip Instance(Modes::Deflate, Level);
+
+            if (Instance.Level != Level)
+            {
+                deflateReset(&Instance.Stream);
+                deflateParams(&Instance.Stream, Level, Z_DEFAULT_STRATEGY);
+                Instance.Level = Level;
+            }
+
+            return Instance;
+        }
+
+        static GZip &Inflater()
+        {
+            thread_local GZip Instance(Modes::Inflate);
+
+            return Instance;
+        }
+
+    private:
+        static constexpr size_t Chunk = 1024 * 16;
+
+        z_stream Stream{};
+        Modes Mode;
+        int Level;
+
+        inline void Reset()
+        {
+            if (Mode == Modes::Deflate)
+                deflateReset(&Stream);
+            else
+                inflateReset(&Stream);
+        }
+    };
+}
@@ -2,217 +2,228 @@
 
 #include <type_traits>
 #include <stdexcept>
+#include <typeinfo>
 #include <utility>
+#include <cstring>
+#include <cstddef>
+#include <memory>
+#include <functional>
 
 namespace Core
 {
-    template <typename>
+    // Unique address per type, compared instead of typeid
+
+    template <typename T>
+    inline constexpr char TypeTag = 0;
+
+    /**
+     * @brief Type erased callable
+     * @tparam Size Bytes of the inline buffer, callables that fit in it and can be moved
+     * without throwing are stored in place, others are allocated on the heap
+     * @tparam Copyable Move-only functions drop the copy constructor and can hold
+     * callables that are not copyable
+     */
+    template <typename, size_t = sizeof(void *), bool = true>
     class Function;
 
-    template <typename TRet, typename... TArgs>
-    class Function<TRet(TArgs...)>
+    template <typename TSignature, size_t Size = sizeof(void *)>
+    using UniqueFunction = Function<TSignature, Size, false>;
+
+    template <typename TRet, typename... TArgs, size_t Size, bool Copyable>
+    class Function<TRet(TArgs...), Size, Copyable>
     {
     public:
-        using TObject = void *;
         using TInvoker = TRet (*)(void *, TArgs &&...);
-        using TDestructor = void (*)(void const *);
-        using TCopyConstructor = void (*)(void **, void const *);
+        using TDestructor = void (*)(void *);
+        using TMover = void (*)(void *, void *);
+        using TCopyConstructor = void (*)(void *, void const *);
+
+        constexpr static size_t SmallSize = Size < sizeof(void *) ? sizeof(void *) : Size;
 
-        constexpr static size_t SmallSize = sizeof(TObject);
+        template <typename T>
+        constexpr static bool IsSmall = sizeof(T) <= SmallSize && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>;
 
         constexpr Function() = default;
 
-        constexpr Function(Function &&Other) noexcept : Object(Other.Object), Invoker(Other.Invoker), Destructor(Other.Destructor), CopyConstructor(Other.CopyConstructor), Hash(Other.Hash)
+        Function(Function &&Other) noexcept : Invoker(Other.Invoker), Destructor(Other.Destructor), Mover(Other.Mover), CopyConstructor(Other.CopyConstructor), Tag(Other.Tag)
         {
-            Other.Object = nullptr;
-            Other.Invoker = nullptr;
-            Other.Destructor = nullptr;
-            Other.CopyConstructor = nullptr;
-            Other.Hash = nullptr;
+            Relocate(Other);
         }
 
-        constexpr Function(Function const &Other) : Invoker(Other.Invoker), Destructor(Other.Destructor), CopyConstructor(Other.CopyConstructor), Hash(Other.Hash)
+        Function(Function const &Other) requires Copyable : Invoker(Other.Invoker), Destructor(Other.Destructor), Mover(Other.Mover), CopyConstructor(Other.CopyConstructor), Tag(Other.Tag)
         {
+            if (!Other.Invoker)
+                return;
+
             Other.AssertCopyable();
 
-            CopyConstructor(&Object, Other.Object);
+            CopyConstructor(Storage, Other.Storage);
         }
 
+        Function(Function const &Other) requires(!Copyable) = delete;
+
         constexpr Function(std::nullptr_t) noexcept {};
 
         template <typename T, typename... TCArgs>
-        constexpr Function(std::type_identity<T>, TCArgs &&...CArgs) : Hash(typeid(T).name())
+        Function(std::type_identity<T>, TCArgs &&...CArgs) : Tag(&TypeTag<T>)
         {
-            if constexpr (sizeof(T) > SmallSize)
+            if constexpr (!IsSmall<T>)
             {
-                Object = new T(std::forward<TCArgs>(CArgs)...);
+                *reinterpret_cast<T **>(Storage) = new T(std::forward<TCArgs>(CArgs)...);
 
-                Invoker = [](void *Item, TArgs &&...Args)
+                Destructor = [](void *Item)
                 {
-                    return static_cast<T *>(Item)->operator()(std::forward<TArgs>(Args)...);
+                    delete *static_cast<T **>(Item);
                 };
 
-                if constexpr (!std::is_trivially_destructible_v<T>)
-                {
-                    Destructor = [](void const *Item)
-                    {
-                        delete static_cast<T const *>(Item);
-                    };
-                }
-                else
-                {
-                    Destructor = nullptr;
-                }
+                // Only the pointer moves
+
+                Mover = nullptr;
 
-                if constexpr (std::is_copy_constructible_v<T> || std::is_trivially_constructible_v<T>)
+                if constexpr (Copyable)
                 {
-                    CopyConstructor = [](void **Self, void const *Other)
+                    if constexpr (std::is_copy_constructible_v<T>)
                     {
-                        *Self = new T(*static_cast<T const *>(Other));
-                    };
-                }
-                else
-                {
-                    CopyConstructor = nullptr;
+                        CopyConstructor = [](void *Self, void const *Other)
+                        {
+                            *static_cast<T **>(Self) = new T(**static_cast<T *const *>(Other));
+                        };
+                    }
                 }
             }
             else
             {
-                std::construct_at(static_cast<T *>(static_cast<void *>(&Object)), std::forward<TCArgs>(CArgs)...);
-
-                Invoker = [](void *Item, TArgs &&...Args)
-                {
-                    return static_cast<T *>(static_cast<void *>(&Item))->operator()(std::forward<TArgs>(Args)...);
-                };
+                std::construct_at(reinterpret_cast<T *>(Storage), std::forward<TCArgs>(CArgs)...);
 
                 if constexpr (!std::is_trivially_destructible_v<T>)
                 {
-                    Destructor = [](void const *Item)
+                    Destructor = [](void *Item)
                     {
-                        static_cast<T const *>(static_cast<void *>(&Item))->~T();
+                        std::destroy_at(static_cast<T *>(Item));
                     };
                 }
-                else
-                {
-                    Destructor = nullptr;
-                }
 
-                if constexpr (std::is_copy_constructible_v<T> || std::is_trivially_constructible_v<T>)
+                // Trivially copyable callables are moved with a plain copy of the buffer
+
+                if constexpr (!std::is_trivially_copyable_v<T>)
                 {
-                    CopyConstructor = [](void **Self, void const *Other)
+                    Mover = [](void *Self, void *Other)
                     {
-                        std::construct_at(static_cast<T *>(static_cast<void *>(Self)), *static_cast<T const *>(static_cast<void *>(&Other)));
+                        std::construct_at(static_cast<T *>(Self), std::move(*static_cast<T *>(Other)));
+                        std::destroy_at(static_cast<T *>(Other));
                     };
                 }
-                else
+
+                if constexpr (Copyable)
                 {
-                    CopyConstructor = nullptr;
+                    if constexpr (std::is_copy_constructible_v<T>)
+                    {
+                        CopyConstructor = [](void *Self, void const *Other)
+                        {
+                            std::construct_at(static_cast<T *>(Self), *static_cast<T const *>(Other));
+                        };
+                    }
                 }
             }
+
+            Invoker = [](void *Item, TArgs &&...Args) -> TRet
+            {
+                return std::invoke(*Get<T>(Item), std::forward<TArgs>(Args)...);
+            };
         }
 
         template <typename TFunctor>
-        constexpr Function(TFunctor &&Functor) noexcept
-            : Function(std::type_identity<TFunctor>{}, std::forward<TFunctor>(Functor)) {}
-
-        constexpr Function(TRet (*Function)(TArgs...)) noexcept
-            : Object(reinterpret_cast<void *>(Function)),
-              Invoker(
-                  [](void *Item, TArgs &&...Args)
-                  {
-                      return (reinterpret_cast<TRet (*)(TArgs...)>(Item))(std::forward<TArgs>(Args)...);
-                  }),
-              Destructor(nullptr),
-              CopyConstructor(
-                  [](void **Self, void const *Other)
-                  {
-                      // @todo Fix this!!
-
-                      *Self = (void *)Other;
-                  }),
-              Hash(typeid(decltype(Function)).name()) {}
+        requires(!std::is_same_v<std::decay_t<TFunctor>, Function>)
+        Function(TFunctor &&Functor)
+            : Function(std::type_identity<std::decay_t<TFunctor>>{}, std::forward<TFunctor>(Functor)) {}
 
         template <typename TFunctor>
-        constexpr Function &operator=(TFunctor &&Functor)
-        requires(!std::is_same_v<std::decay_t<TFunctor>, Function>)
+        Function &operator=(TFunctor &&Functor)
+        requires(!std::is_same_v<std::decay_t<TFunctor>, Function> && !std::is_null_pointer_v<std::decay_t<TFunctor>>)
         {
-            // @todo Optimize this
+            *this = Function(std::type_identity<std::decay_t<TFunctor>>{}, std::forward<TFunctor>(Functor));
+
+            return *this;
+        }
 
-            *this = Function(std::type_identity<TFunctor>{}, std::forward<TFunctor>(Functor));
+        Function &operator=(std::nullptr_t)
+        {
+            Clear();
 
             return *this;
         }
 
-        constexpr Function &operator=(Function &&Other) noexcept
+        Function &operator=(Function &&Other) noexcept
         {
             if (this != &Other)
             {
                 Clear();
 
-                Object = Other.Object;
                 Invoker = Other.Invoker;
-                CopyConstructor = Other.CopyConstructor;
                 Destructor = Other.Destructor;
-                Hash = Other.Hash;
+                Mover = Other.Mover;
+                CopyConstructor = Other.CopyConstructor;
+                Tag = Other.Tag;
 
-                Other.Object = nullptr;
-                Other.Invoker = nullptr;
-                Other.CopyConstructor = nullptr;
-                Other.Destructor = nullptr;
-                Other.Hash = nullptr;
+                Relocate(Other);
             }
 
             return *this;
         }
 
-        constexpr Function &operator=(Function const &Other)
+        Function &operator=(Function const &Other) requires Copyable
         {
-            Other.AssertCopyable();
-
-            Clear();
+            if (this != &Other)
+            {
+                Function Copy(Other);
 
-            Invoker = Other.Invoker;
-            CopyConstructor = Other.CopyConstructor;
-            Destructor = Other.Destructor;
-            Hash = Other.Hash;
+                *this = std::move(Copy);
+            }
 
-            CopyConstructor(&Object, Other.Object);
             return *this;
         }
 
-        constexpr ~Function()
+        Function &operator=(Function const &Other) requires(!Copyable) = delete;
+
+        ~Function()
         {
             Clear();
         }
 
         constexpr inline bool IsCopyable() const
         {
-            return CopyConstructor != nullptr;
+            if constexpr (Copyable)
+                return CopyConstructor != nullptr;
+            else
+                return false;
         }
 
-        constexpr void Clear()
+        void Clear()
         {
             if (Destructor)
-            {
-                Destructor(Object);
-                Destructor = nullptr;
-            }
+                Destructor(Storage);
 
             Invoker = nullptr;
+            Destructor = nullptr;
+            Mover = nullptr;
+            Tag = nullptr;
+
+            if constexpr (Copyable)
+                CopyConstructor = nullptr;
         }
 
         template <typename T>
-        constexpr T *Target()
+        T *Target()
         {
-            if (typeid(T).name() != Hash)
+            if (Tag != &TypeTag<T>)
                 throw std::bad_cast();
 
-            return static_cast<T *>(Object);
+            return Get<T>(Storage);
         }
 
-        constexpr inline TRet operator()(TArgs... Args) const
+        inline TRet operator()(TArgs... Args) const
         {
-            return Invoker(Object, std::forward<TArgs>(Args)...);
+            return Invoker(Storage, std::forward<TArgs>(Args)...);
         }
 
         constexpr inline operator bool() const
@@ -221,16 +232,53 @@ namespace Core
         }
 
     protected:
-        TObject Object = nullptr;
+        struct Empty
+        {
+            constexpr Empty() = default;
+            constexpr Empty(std::nullptr_t) {}
+        };
+
+        alignas(std::max_align_t) mutable unsigned char Storage[SmallSize];
         TInvoker Invoker = nullptr;
         TDestructor Destructor = nullptr;
-        TCopyConstructor CopyConstructor = nullptr;
-        char const *Hash = nullptr;
+        TMover Mover = nullptr;
+        [[no_unique_address]] std::conditional_t<Copyable, TCopyConstructor, Empty> CopyConstructor = nullptr;
+        char const *Tag = nullptr;
+
+        template <typename T>
+        static inline T *Get(void *Item)
+        {
+            if constexpr (IsSmall<T>)
+                return static_cast<T *>(Item);
+            else
+                return *static_cast<T **>(Item);
+        }
+
+        // Takes over the callable of Other whose operations were already copied
+
+        void Relocate(Function &Other) noexcept
+        {
+            if (Other.Invoker)
+            {
+                if (Mover)
+                    Mover(Storage, Other.Storage);
+                else
+                    memcpy(Storage, Other.Storage, SmallSize);
+            }
+
+            Other.Invoker = nullptr;
+            Other.Destructor = nullptr;
+            Other.Mover = nullptr;
+            Other.Tag = nullptr;
+
+            if constexpr (Copyable)
+                Other.CopyConstructor = nullptr;
+        }
 
-        constexpr inline void AssertCopyable() const
+        inline void AssertCopyable() const
         {
             if (!IsCopyable())
                 throw std::runtime_error("No suitable copy constructor");
         }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <tuple>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <sys/uio.h>
+
+#include <Iterable/MemoryHolder.hpp>
+
+namespace Core::Iterable
+{
+    /**
+     * @brief Append only linear buffer
+     * Content always sits in one contiguous block, consumed items only move the
+     * head forward and the content is moved back to the start when the tail
+     * runs out of room, so parsers never see the data split in two.
+     */
+    template <typename T>
+    class Buffer final
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Buffer only holds trivially copyable items");
+
+    public:
+        constexpr Buffer() = default;
+        constexpr Buffer(size_t Size) : _Content(Size) {}
+
+        constexpr Buffer(Buffer &&Other) : _Content(std::move(Other._Content)), _First(Other._First), _Length(Other._Length)
+        {
+            Other._First = 0;
+            Other._Length = 0;
+        }
+
+        constexpr Buffer &operator=(Buffer &&Other)
+        {
+            if (this != &Other)
+            {
+                _Content = std::move(Other._Content);
+                _First = Other._First;
+                _Length = Other._Length;
+
+                Other._First = 0;
+                Other._Length = 0;
+            }
+
+            return *this;
+        }
+
+        Buffer(Buffer const &Other) = delete;
+        Buffer &operator=(Buffer const &Other) = delete;
+
+        constexpr inline T *Content() { return _Content.Content() + _First; }
+        constexpr inline T const *Content() const { return _Content.Content() + _First; }
+
+        constexpr inline size_t Length() const noexcept { return _Length; }
+        constexpr inline size_t Capacity() const noexcept { return _Content.Length(); }
+        constexpr inline bool IsEmpty() const noexcept { return _Length == 0; }
+
+        // Room left after the tail
+
+        constexpr inline size_t IsFree() const noexcept { return Capacity() - _First - _Length; }
+
+        constexpr inline std::tuple<T *, size_t> DataChunk()
+        {
+            return std::make_tuple(Content(), _Length);
+        }
+
+        constexpr inline std::tuple<T *, size_t> EmptyChunk()
+        {
+            return std::make_tuple(Content() + _Length, IsFree());
+        }
+
+        constexpr size_t EmptyVectors(struct iovec *Vector)
+        {
+            Vector[0].iov_base = reinterpret_cast<void *>(Content() + _Length);
+            Vector[0].iov_len = IsFree() * sizeof(T);
+
+            return 1;
+        }
+
+        constexpr inline void AdvanceTail(size_t Count = 1)
+        {
+            _Length += Count;
+        }
+
+        /**
+         * @brief Makes room for at least Minimum items after the tail
+         * Consumed space at the front is reused before the block is reallocated
+         */
+        constexpr void IncreaseCapacity(size_t Minimum = 1)
+        {
+            if (IsFree() >= Minimum)
+                return;
+
+            if (Capacity() - _Length >= Minimum && _First >= _Length)
+            {
+                Compact();
+                return;
+            }
+
+            Resize(Capacity() * 2 + Minimum);
+        }
+
+        constexpr void CopyFrom(T const *Data, size_t Count)
+        {
+            IncreaseCapacity(Count);
+
+            std::memcpy(Content() + _Length, Data, Count * sizeof(T));
+
+            _Length += Count;
+        }
+
+        // Consumes items from the front without moving the rest
+
+        constexpr void Free(size_t Count)
+        {
+            if (_Length < Count)
+                throw std::out_of_range("");
+
+            _Length -= Count;
+            _First = _Length == 0 ? 0 : _First + Count;
+        }
+
+        /**
+         * @brief Removes items from the middle, the items after them are moved down
+         * Removing from the front only moves the head
+         */
+        constexpr void Erase(size_t Index, size_t Count)
+        {
+            if (Index + Count > _Length)
+                throw std::out_of_range("");
+
+            if (Index == 0)
+            {
+                Free(Count);
+                return;
+            }
+
+            std::memmove(Content() + Index, Content() + Index + Count, (_Length - Index - Count) * sizeof(T));
+
+            _Length -= Count;
+        }
+
+        constexpr void Free()
+        {
+            _First = 0;
+            _Length = 0;
+        }
+
+        /**
+         * @brief Moves the content to the start of the block
+         * Costs as much as the remaining content and never allocates
+         */
+        constexpr void Compact()
+        {
+            if (_First == 0)
+                return;
+
+            std::memmove(_Content.Content(), Content(), _Length * sizeof(T));
+
+            _First = 0;
+        }
+
+        constexpr void Resize(size_t Size)
+        {
+            if (Size < _Length)
+                throw std::out_of_range("");
+
+            auto NewContent = MemoryHolder<T>(Size);
+
+            std::memcpy(NewContent.Content(), Content(), _Length * sizeof(T));
+
+            _Content = std::move(NewContent);
+            _First = 0;
+        }
+
+    private:
+        MemoryHolder<T> _Content;
+        size_t _First = 0;
+        size_t _Length = 0;
+    };
+}
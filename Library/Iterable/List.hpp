@@ -25,7 +25,7 @@ namespace Core::Iterable
                 Add(Item);
         }
 
-        constexpr List(List const &Other) : _Content(Other._Content), _Length(Other._Length), _Growable(Other._Growable)
+        constexpr List(List const &Other) requires std::is_copy_constructible_v<T> : _Content(Other._Content), _Length(Other._Length), _Growable(Other._Growable)
         {
             for (size_t i = 0; i < _Length; i++)
             {
@@ -46,7 +46,7 @@ namespace Core::Iterable
 
         // Operators
 
-        constexpr List &operator=(List const &Other)
+        constexpr List &operator=(List const &Other) requires std::is_copy_constructible_v<T>
         {
             if (this != &Other)
             {
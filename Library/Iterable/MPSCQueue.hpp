@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace Core::Iterable
+{
+    /**
+     * @brief Unbounded lock-free multi-producer single-consumer queue
+     * Any thread may Add, only the owning thread may Take or Consume.
+     * Based on Dmitry Vyukov's intrusive MPSC node queue, Add is wait-free
+     * and the consumer never blocks producers.
+     * T must be default constructible since the queue keeps a stub node.
+     */
+    template <typename T>
+    class MPSCQueue final
+    {
+    public:
+        // Constructors
+
+        MPSCQueue() : _Head(new Node), _Tail(_Head.load(std::memory_order_relaxed)) {}
+
+        MPSCQueue(MPSCQueue const &Other) = delete;
+
+        // Moving is only safe while no producer is using either instance
+
+        MPSCQueue(MPSCQueue &&Other) : _Head(Other._Head.load(std::memory_order_relaxed)), _Tail(Other._Tail)
+        {
+            Other._Tail = new Node;
+            Other._Head.store(Other._Tail, std::memory_order_relaxed);
+        }
+
+        ~MPSCQueue()
+        {
+            Free();
+
+            delete _Tail;
+        }
+
+        // Operators
+
+        MPSCQueue &operator=(MPSCQueue const &Other) = delete;
+
+        MPSCQueue &operator=(MPSCQueue &&Other)
+        {
+            if (this != &Other)
+            {
+                Free();
+
+                std::swap(_Tail, Other._Tail);
+
+                auto Head = _Head.load(std::memory_order_relaxed);
+                _Head.store(Other._Head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                Other._Head.store(Head, std::memory_order_relaxed);
+            }
+
+            return *this;
+        }
+
+        // Peroperties
+
+        /**
+         * @brief Only meaningful on the consumer thread
+         * A producer that is half way through Add may still be missed
+         */
+        inline bool IsEmpty() const noexcept
+        {
+            return _Tail->Next.load(std::memory_order_acquire) == nullptr;
+        }
+
+        // Adding functionality
+
+        template <typename... TArgs>
+        void Add(TArgs &&...Args)
+        {
+            auto Item = new Node{{nullptr}, T(std::forward<TArgs>(Args)...)};
+
+            auto Previous = _Head.exchange(Item, std::memory_order_acq_rel);
+
+            // Consumer stops at this link until it is published
+
+            Previous->Next.store(Item, std::memory_order_release);
+        }
+
+        // Take functionality
+
+        bool Take(T &Item)
+        {
+            auto Next = _Tail->Next.load(std::memory_order_acquire);
+
+            if (!Next)
+                return false;
+
+            Item = std::move(Next->Value);
+
+            delete _Tail;
+            _Tail = Next;
+
+            return true;
+        }
+
+        /**
+         * @brief Runs Action on every published item and removes it
+         * @return Count of consumed items
+         */
+        template <typename TCallback>
+        size_t Consume(TCallback Action)
+        {
+            size_t Count = 0;
+            Node *Next = nullptr;
+
+            while ((Next = _Tail->Next.load(std::memory_order_acquire)))
+            {
+                delete _Tail;
+                _Tail = Next;
+
+                // Node now acts as the stub, so value can be used in place
+
+                Action(Next->Value);
+                Next->Value = T();
+
+                Count++;
+            }
+
+            return Count;
+        }
+
+        // Remove functionality
+
+        void Free()
+        {
+            Node *Next = nullptr;
+
+            while ((Next = _Tail->Next.load(std::memory_order_acquire)))
+            {
+                delete _Tail;
+                _Tail = Next;
+            }
+
+            _Tail->Value = T();
+        }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node *> Next{nullptr};
+            T Value{};
+        };
+
+        // Producers end
+
+        alignas(64) std::atomic<Node *> _Head;
+
+        // Consumers end
+
+        alignas(64) Node *_Tail;
+    };
+}
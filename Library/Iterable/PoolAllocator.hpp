@@ -0,0 +1,105 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+
+namespace Core::Iterable
+{
+    /**
+     * @brief Node allocator that keeps freed single objects in a free list
+     * Lists only ever allocate one node at a time so after warming up
+     * insertions and erasures stop reaching malloc.
+     * Free lists are per thread, and since every event loop runs on its own
+     * thread, each loop effectively gets its own pool without any locking.
+     * The allocator is stateless so containers using it can splice between each other.
+     */
+    template <typename T>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        constexpr PoolAllocator() noexcept = default;
+
+        template <typename U>
+        constexpr PoolAllocator(PoolAllocator<U> const &) noexcept {}
+
+        T *allocate(size_t Count)
+        {
+            if (Count != 1)
+                return static_cast<T *>(::operator new(Count * sizeof(T)));
+
+            auto &Pool = Local();
+
+            if (!Pool.Head)
+                return static_cast<T *>(::operator new(sizeof(Block)));
+
+            auto Item = Pool.Head;
+            Pool.Head = Item->Next;
+            Pool.Length--;
+
+            return reinterpret_cast<T *>(Item);
+        }
+
+        void deallocate(T *Pointer, size_t Count) noexcept
+        {
+            if (Count != 1)
+            {
+                ::operator delete(Pointer);
+                return;
+            }
+
+            auto &Pool = Local();
+
+            if (Pool.Length >= Limit)
+            {
+                ::operator delete(Pointer);
+                return;
+            }
+
+            auto Item = reinterpret_cast<Block *>(Pointer);
+            Item->Next = Pool.Head;
+            Pool.Head = Item;
+            Pool.Length++;
+        }
+
+        template <typename U>
+        constexpr bool operator==(PoolAllocator<U> const &) const noexcept { return true; }
+
+        template <typename U>
+        constexpr bool operator!=(PoolAllocator<U> const &) const noexcept { return false; }
+
+    private:
+        // Upper bound of cached nodes per thread and type
+
+        static constexpr size_t Limit = 1 << 16;
+
+        union Block
+        {
+            Block *Next;
+            alignas(T) unsigned char Storage[sizeof(T)];
+        };
+
+        struct FreeList
+        {
+            Block *Head = nullptr;
+            size_t Length = 0;
+
+            ~FreeList()
+            {
+                while (Head)
+                {
+                    auto Next = Head->Next;
+                    ::operator delete(Head);
+                    Head = Next;
+                }
+            }
+        };
+
+        static FreeList &Local()
+        {
+            thread_local FreeList Pool;
+            return Pool;
+        }
+    };
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <Iterable/Buffer.hpp>
+#include <Network/HTTP/Response.hpp>
+#include <Network/HTTP/RequestView.hpp>
+
+namespace Core::Network::HTTP
+{
+    /**
+     * @brief Content codings of a connection, set up by Modules::Compression
+     * The coders are plain function pointers so connections that do not
+     * compress need not link the compression libraries.
+     */
+    struct Codec
+    {
+        enum Encodings : uint8_t
+        {
+            Identity = 0,
+            GZip = 1 << 0,
+            Brotli = 1 << 1,
+        };
+
+        int Level = 6;
+
+        // Smaller content is sent as is, the coded form would hardly be smaller
+
+        size_t MinSize = 1024;
+
+        // Files are looked up with .br and .gz siblings, off by default since a missing one costs a failed open()
+
+        bool Precompressed = false;
+
+        void (*Encode)(std::string_view Content, Iterable::Buffer<char> &Output, int Level) = nullptr;
+        void (*Decode)(std::string_view Content, Iterable::Buffer<char> &Output, size_t Limit) = nullptr;
+
+        /**
+         * @brief Codings of an accept-encoding value that the codec knows
+         * Codings with a zero quality are refused, a wildcard accepts all of them
+         */
+        static uint8_t Accepted(std::string_view Header)
+        {
+            uint8_t Result = Identity;
+
+            while (!Header.empty())
+            {
+                auto End = Header.find(',');
+                auto Item = Header.substr(0, End);
+
+                Header = End == std::string_view::npos ? std::string_view{} : Header.substr(End + 1);
+
+                auto Parameters = Item.find(';');
+                auto Name = Trim(Item.substr(0, Parameters));
+
+                if (Parameters != std::string_view::npos && IsZeroQuality(Item.substr(Parameters + 1)))
+                    continue;
+
+                if (EqualsIgnoreCase(Name, "gzip") || EqualsIgnoreCase(Name, "x-gzip"))
+                    Result |= GZip;
+                else if (EqualsIgnoreCase(Name, "br"))
+                    Result |= Brotli;
+                else if (Name == "*")
+                    Result |= GZip | Brotli;
+            }
+
+            return Result;
+        }
+
+        /**
+         * @brief Vary value that names accept-encoding as well
+         * A value that already does, or varies on everything, is kept as it is
+         */
+        static std::string Vary(std::string_view Current)
+        {
+            for (auto Rest = Current; !Rest.empty();)
+            {
+                auto End = Rest.find(',');
+                auto Name = Trim(Rest.substr(0, End));
+
+                if (Name == "*" || EqualsIgnoreCase(Name, "accept-encoding"))
+                    return std::string{Current};
+
+                Rest = End == std::string_view::npos ? std::string_view{} : Rest.substr(End + 1);
+            }
+
+            if (Trim(Current).empty())
+                return "accept-encoding";
+
+            return std::string{Current} + ", accept-encoding";
+        }
+
+        // Merges accept-encoding into the vary header of a response, or adds one
+
+        static void AddVary(HTTP::Response &Response)
+        {
+            for (auto &[k, v] : Response.Headers)
+            {
+                if (EqualsIgnoreCase(k, "vary"))
+                {
+                    v = Vary(v);
+                    return;
+                }
+            }
+
+            Response.Headers.emplace("vary", "accept-encoding");
+        }
+
+        /**
+         * @brief Whether a response is worth encoding
+         * Only textual types are, the others are mostly compressed already, and
+         * never a range since its bounds count bytes of the content as it is
+         */
+        bool ShouldEncode(HTTP::Response const &Response) const
+        {
+            if (!Encode || Response.Content.length() < MinSize || Response.Status == HTTP::Status::PartialContent)
+                return false;
+
+            std::string_view Type;
+
+            for (auto const &[k, v] : Response.Headers)
+            {
+                // A set length, coding or range belongs to the content as it is
+
+                if (EqualsIgnoreCase(k, "content-encoding") || EqualsIgnoreCase(k, "content-length") || EqualsIgnoreCase(k, "content-range"))
+                    return false;
+
+                if (EqualsIgnoreCase(k, "content-type"))
+                    Type = v;
+            }
+
+            return IsTextual(Type);
+        }
+
+        static bool IsTextual(std::string_view Type)
+        {
+            Type = Trim(Type.substr(0, Type.find(';')));
+
+            if (Type.starts_with("text/"))
+                return true;
+
+            for (std::string_view Suffix : {"/json", "+json", "/javascript", "/xml", "+xml", "/wasm"})
+            {
+                if (Type.ends_with(Suffix))
+                    return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Scratch buffer of this thread for encoded content
+         * Keeps its capacity so encoding a response does not allocate once warmed up
+         */
+        static Iterable::Buffer<char> &Scratch()
+        {
+            thread_local Iterable::Buffer<char> Buffer(1024 * 16);
+
+            return Buffer;
+        }
+
+    private:
+        static std::string_view Trim(std::string_view Value)
+        {
+            while (!Value.empty() && (Value.front() == ' ' || Value.front() == '\t'))
+                Value.remove_prefix(1);
+
+            while (!Value.empty() && (Value.back() == ' ' || Value.back() == '\t'))
+                Value.remove_suffix(1);
+
+            return Value;
+        }
+
+        static bool IsZeroQuality(std::string_view Parameters)
+        {
+            auto Start = Parameters.find("q=");
+
+            if (Start == std::string_view::npos)
+                return false;
+
+            auto Value = Trim(Parameters.substr(Start + 2));
+
+            if (Value.empty() || Value[0] != '0')
+                return false;
+
+            for (size_t i = 1; i < Value.length(); i++)
+            {
+                if (Value[i] != '.' && Value[i] != '0')
+                    return false;
+            }
+
+            return true;
+        }
+    };
+}
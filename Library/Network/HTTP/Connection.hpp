@@ -1,14 +1,19 @@
 #pragma once
 
 #include <string>
+#include <climits>
+#include <charconv>
+#include <algorithm>
 
 #include <File.hpp>
 #include <Duration.hpp>
 #include <Format/Stream.hpp>
 #include <Network/HTTP/Response.hpp>
+#include <Network/HTTP/PreparedResponse.hpp>
 #include <Network/HTTP/Request.hpp>
 #include <Network/TLSContext.hpp>
 #include <Network/HTTP/Parser.hpp>
+#include <Network/HTTP/Codec.hpp>
 
 namespace Core
 {
@@ -18,11 +23,87 @@ namespace Core
         {
             struct Connection
             {
+                /**
+                 * @brief Response slot of one request
+                 * Slots are taken in request order, a slot whose handler answers
+                 * later holds back the slots behind it until it is ready
+                 */
                 struct OutEntry
                 {
                     Iterable::Queue<char> Buffer;
                     File FilePtr;
-                    size_t FileContentLength;
+                    size_t FileContentLength = 0;
+                    bool Ready = true;
+
+                    // Parts of a prepared response sent before and after Buffer
+
+                    std::shared_ptr<std::string const> Shared;
+                    std::string_view Head;
+                    std::string_view Tail;
+
+                    // File shared with other responses, it is read from FileOffset so
+                    // its descriptor position is never moved. Offset is negative when
+                    // the file is read from its position instead.
+
+                    std::shared_ptr<File const> SharedFile;
+                    off_t FileOffset = -1;
+
+                    // Streamed response, the slot stays at the head until its writer ends it
+
+                    bool Open = false;
+                    bool Chunked = false;
+                    bool Throttled = false;
+                    Core::Function<void()> OnWritable;
+
+                    // Has something to send now, an open stream may be waiting for its writer
+
+                    inline bool IsSendable() const
+                    {
+                        return Ready && (!Open || HasData());
+                    }
+
+                    inline bool HasData() const
+                    {
+                        return !Head.empty() || !Buffer.IsEmpty() || !Tail.empty();
+                    }
+
+                    size_t DataVectors(struct iovec *Vector)
+                    {
+                        size_t Count = 0;
+
+                        if (!Head.empty())
+                            Vector[Count++] = {const_cast<char *>(Head.data()), Head.length()};
+
+                        if (!Buffer.IsEmpty())
+                            Count += Buffer.DataVectors(Vector + Count);
+
+                        if (!Tail.empty())
+                            Vector[Count++] = {const_cast<char *>(Tail.data()), Tail.length()};
+
+                        return Count;
+                    }
+
+                    /**
+                     * @brief Drops sent bytes from the front
+                     * @return Bytes taken from this entry
+                     */
+                    size_t Consume(size_t Count)
+                    {
+                        size_t Taken = std::min(Count, Head.length());
+
+                        Head.remove_prefix(Taken);
+
+                        size_t Length = std::min(Count - Taken, Buffer.Length());
+
+                        Buffer.Free(Length);
+                        Taken += Length;
+
+                        Length = std::min(Count - Taken, Tail.length());
+
+                        Tail.remove_prefix(Length);
+
+                        return Taken + Length;
+                    }
                 };
 
                 struct Context : public Async::EventLoop::Context
@@ -30,17 +111,65 @@ namespace Core
                     Network::EndPoint const &Target;
                     Network::EndPoint const &Source;
 
-                    inline bool IsSecure()
+                    // Slot of the request being handled, copies of the context
+                    // kept by asynchronous handlers answer into the same slot
+
+                    size_t Sequence = 0;
+
+                    // Content codings the client of the request accepts, see HTTP::Codec
+
+                    uint8_t Encodings = Codec::Identity;
+
+                    // Codings the precompressed siblings of files may be sent in, none when the codec does not look them up
+
+                    inline uint8_t SiblingEncodings() const
+                    {
+                        auto const *Coding = HandlerAs<HTTP::Connection>().Setting.Coding;
+
+                        return Coding && Coding->Precompressed ? Encodings : static_cast<uint8_t>(Codec::Identity);
+                    }
+
+                    inline bool IsSecure() const
                     {
                         return HandlerAs<HTTP::Connection>().IsSecure();
                     }
 
-                    inline bool HasKTLS()
+                    // Kernel TLS offload of the connection, files are sent with plain sendfile when sending is offloaded
+
+                    inline bool HasKTLS() const
                     {
-                        return false;
+                        return HandlerAs<HTTP::Connection>().SSL.KernelSend;
+                    }
+
+                    inline bool HasKTLSReceive() const
+                    {
+                        return HandlerAs<HTTP::Connection>().SSL.KernelReceive;
+                    }
+
+                    // Handshake of the connection resumed an earlier session
+
+                    inline bool IsResumed() const
+                    {
+                        return HandlerAs<HTTP::Connection>().SSL.Resumed;
+                    }
+
+                    /**
+                     * @brief Handshake and resumption counters of the listener the connection came from
+                     * All zero for plain connections
+                     */
+                    inline TLSSessions::Statistics TLSStatistics() const
+                    {
+                        auto &SSL = HandlerAs<HTTP::Connection>().SSL;
+
+                        if (!SSL)
+                            return {};
+
+                        auto *Sessions = TLSSessions::Of(SSL.ssl);
+
+                        return Sessions ? Sessions->Report() : TLSSessions::Statistics{};
                     }
 
-                    inline bool CanUseSendFile()
+                    inline bool CanUseSendFile() const
                     {
                         auto s = IsSecure();
                         return !s || (s && HasKTLS());
@@ -50,18 +179,113 @@ namespace Core
                     {
                         Loop.AssertPermission();
 
-                        HandlerAs<HTTP::Connection>().AppendResponse(Response, std::move(file), FileLength);
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.AppendResponse(*this, Response, std::move(file), FileLength);
+                        Handler.Flush(*this);
+                    }
+
+                    /**
+                     * @brief Sends Length bytes of a file shared between responses, starting at Offset
+                     * The file is read at an offset so one open descriptor can serve all of them
+                     */
+                    inline void SendResponse(HTTP::Response const &Response, std::shared_ptr<File const> file, size_t Offset, size_t Length) const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.AppendShared(*this, Response, std::move(file), Offset, Length);
+                        Handler.Flush(*this);
+                    }
+
+                    /**
+                     * @brief Sends a prepared response without serializing it again
+                     * @param Content Content of a template, ignored for complete responses
+                     */
+                    inline void SendResponse(HTTP::PreparedResponse const &Prepared, std::string_view Content = {}) const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.AppendPrepared(*this, Prepared, Content);
+                        Handler.Flush(*this);
+                    }
+
+                    /**
+                     * @brief Sends a file as the content of a response
+                     * A precompressed .br or .gz sibling is sent instead when the codec
+                     * looks for them and the client accepts its coding
+                     */
+                    inline void SendFile(HTTP::Response Response, std::string const &Path) const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
 
-                        ListenFor(ePoll::In | ePoll::Out);
+                        Handler.AppendFile(*this, std::move(Response), Path);
+                        Handler.Flush(*this);
                     }
 
                     inline void SendBuffer(Iterable::Queue<char> Buffer, File file = {}, size_t FileLength = 0) const
                     {
                         Loop.AssertPermission();
 
-                        HandlerAs<HTTP::Connection>().AppendBuffer(std::move(Buffer), std::move(file), FileLength);
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.AppendBuffer(Sequence, std::move(Buffer), std::move(file), FileLength);
+                        Handler.Flush(*this);
+                    }
+
+                    /**
+                     * @brief Sends the head of a response whose body is written with SendChunk()
+                     * The body is sent chunked, or until the connection closes for HTTP/1.0 clients
+                     */
+                    inline void StreamResponse(HTTP::Response const &Response) const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.AppendStream(*this, Response);
+                        Handler.Flush(*this);
+                    }
+
+                    /**
+                     * @brief Queues a piece of a streamed response
+                     * @return False once the queued data reached the high watermark, the
+                     * writer should then wait for OnWritable()
+                     */
+                    inline bool SendChunk(std::string_view Data) const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        bool Result = Handler.AppendChunk(Sequence, Data);
+                        Handler.Flush(*this);
+
+                        return Result;
+                    }
+
+                    inline void EndStream() const
+                    {
+                        Loop.AssertPermission();
+
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        Handler.CloseStream(Sequence);
+                        Handler.Flush(*this);
+                    }
 
-                        ListenFor(ePoll::In | ePoll::Out);
+                    /**
+                     * @brief Called when a throttled stream was sent down to the low watermark
+                     */
+                    template <typename TCallback>
+                    inline void OnWritable(TCallback &&Callback) const
+                    {
+                        HandlerAs<HTTP::Connection>().Slot(Sequence).OnWritable = std::forward<TCallback>(Callback);
                     }
 
                     inline bool WillClose()
@@ -69,6 +293,59 @@ namespace Core
                         return HandlerAs<HTTP::Connection>().ShouldClose;
                     }
 
+                    /**
+                     * @brief Receives the body of the request piece by piece as it arrives, needs StreamBody
+                     * Has to be set from the request handler. The callback may return false to stop
+                     * reading from the socket until ResumeBody() is called.
+                     */
+                    template <typename TCallback>
+                    inline void OnBodyChunk(TCallback &&Callback) const
+                    {
+                        auto &Handler = HandlerAs<HTTP::Connection>();
+
+                        if constexpr (std::is_void_v<std::invoke_result_t<TCallback &, std::string_view>>)
+                        {
+                            Handler.Parser.Sink = [Callback = std::forward<TCallback>(Callback)](std::string_view Data) mutable
+                            {
+                                Callback(Data);
+                                return true;
+                            };
+                        }
+                        else
+                        {
+                            Handler.Parser.Sink = std::forward<TCallback>(Callback);
+                        }
+                    }
+
+                    // Called once the whole body of a streamed request was received
+
+                    template <typename TCallback>
+                    inline void OnBodyEnd(TCallback &&Callback) const
+                    {
+                        HandlerAs<HTTP::Connection>().BodyEnd = std::forward<TCallback>(Callback);
+                    }
+
+                    inline void ResumeBody() const
+                    {
+                        Loop.AssertPermission();
+
+                        HandlerAs<HTTP::Connection>().Resume(*this);
+                    }
+
+                    /**
+                     * @brief Writes the body of a streamed request to a file as it arrives
+                     * so large uploads never sit in memory
+                     */
+                    inline void SpillBody(File file) const
+                    {
+                        OnBodyChunk(
+                            [file = std::move(file)](std::string_view Data) mutable
+                            {
+                                while (!Data.empty())
+                                    Data.remove_prefix(file.Write(Data.data(), Data.length()));
+                            });
+                    }
+
                     template <typename TCallback>
                     inline void OnRemove(TCallback &&Callback)
                     {
@@ -99,12 +376,26 @@ namespace Core
                     bool NoDelay;
                     bool RawContent;
                     Duration Timeout;
+                    bool EdgeTriggered;
+                    bool ZeroCopy;
+                    bool StreamBody;
+                    size_t HighWatermark;
+                    size_t LowWatermark;
+                    Codec const *Coding = nullptr;
                 };
 
+                // Registered once in edge triggered mode, writability is then tracked in user space
+
+                static constexpr ePoll::Event EdgeEvents = ePoll::In | ePoll::Out | ePoll::ReadHangUp | ePoll::EdgeTriggered;
+
+                // Piece of a file read at once for TLS without kernel offload, one full record
+
+                static constexpr size_t FileChunk = 1024 * 16;
+
                 Network::EndPoint Target;
                 Network::EndPoint Source;
 
-                Iterable::Queue<char> IBuffer = Iterable::Queue<char>(1);
+                Iterable::Buffer<char> IBuffer = Iterable::Buffer<char>(1);
                 Iterable::Queue<OutEntry> OBuffer = Iterable::Queue<OutEntry>(1);
                 Settings const &Setting;
                 TLSContext::SecureSocket SSL;
@@ -113,11 +404,30 @@ namespace Core
                 Core::Function<void()> OnRemove;
                 Core::Function<void()> OnReceived;
                 Core::Function<void()> OnSent;
+                Core::Function<void()> BodyEnd;
 
                 // @todo Fix this limitations
-                HTTP::Parser<HTTP::Request> Parser{Setting.MaxHeaderSize, Setting.MaxBodySize, Setting.RequestBufferSize, IBuffer, Setting.RawContent};
+                HTTP::Parser<HTTP::Request> Parser{Setting.MaxHeaderSize, Setting.MaxBodySize, Setting.RequestBufferSize, IBuffer, Setting.RawContent, Setting.ZeroCopy, Setting.StreamBody, Setting.Coding};
                 bool ShouldClose = false;
 
+                // Request at the parser was given to the handler, streamed ones are before their body
+
+                bool Dispatched = false;
+
+                // Sequence number of the request that owns the slot at the head of OBuffer
+
+                size_t Retired = 0;
+
+                // Level triggered interest as registered with the loop
+
+                ePoll::Event Listening = ePoll::In;
+
+                // Edge triggered state
+
+                bool Writable = false;
+                bool Dispatching = false;
+                bool Dropped = false;
+
                 Connection(Network::EndPoint const &target, Network::EndPoint const &source, Settings &setting)
                     : Target(target),
                       Source(source),
@@ -141,7 +451,8 @@ namespace Core
                                                  IBuffer(std::move(Other.IBuffer)),
                                                  OBuffer(std::move(Other.OBuffer)),
                                                  Setting(Other.Setting),
-                                                 SSL(std::move(Other.SSL))
+                                                 SSL(std::move(Other.SSL)),
+                                                 Writable(Other.Writable)
                 {
                 }
 
@@ -162,7 +473,7 @@ namespace Core
 
                     // Ensure version is HTTP 1.1
 
-                    if (Parser.Result.Version[5] == '1' && Parser.Result.Version[7] == '0')
+                    if (Parser.Result.View.Version == HTTP::HTTP10)
                     {
                         throw HTTP::Status::ExpectationFailed;
                     }
@@ -179,12 +490,12 @@ namespace Core
                     // @todo Maybe handle HTTP 2.0 later too?
                     // @todo Fix this and use actual request
 
-                    constexpr auto ContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+                    constexpr std::string_view ContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
 
-                    Iterable::Queue<char> Temp(sizeof(ContinueResponse), false);
+                    Iterable::Queue<char> Temp(ContinueResponse.length(), false);
                     Format::Stream Stream(Temp);
 
-                    Temp.CopyFrom(ContinueResponse, sizeof(Stream));
+                    Temp.CopyFrom(ContinueResponse.data(), ContinueResponse.length());
 
                     // Send the response
 
@@ -199,229 +510,954 @@ namespace Core
                     return true;
                 }
 
-                inline void AppendBuffer(Iterable::Queue<char> Buffer, File file = {}, size_t FileLength = 0)
+                /**
+                 * @brief Takes the response slot of the next request
+                 * @return Sequence number the response has to be appended with
+                 */
+                inline size_t Reserve()
                 {
-                    OBuffer.Insert({std::move(Buffer), std::move(file), FileLength});
+                    OutEntry Item;
+
+                    Item.Buffer = Iterable::Queue<char>(1);
+                    Item.Ready = false;
+
+                    OBuffer.Insert(std::move(Item));
+
+                    return Retired + OBuffer.Length() - 1;
                 }
 
-                void AppendResponse(HTTP::Response const &Response, File file = {}, size_t FileLength = 0)
+                inline OutEntry &Slot(size_t Sequence)
                 {
-                    size_t StringLength = 0;
-                    auto Buffer = Iterable::Queue<char>(Setting.ResponseBufferSize);
-                    Format::Stream Ser(Buffer);
+                    if (Sequence < Retired || Sequence - Retired >= OBuffer.Length())
+                        throw std::out_of_range("No pending request with this sequence");
 
-                    // Serialize first line
+                    return OBuffer[Sequence - Retired];
+                }
 
-                    Ser << "HTTP/" << Response.Version << ' ' << std::to_string(static_cast<unsigned short>(Response.Status)) << ' ' << Response.Brief << "\r\n";
+                void AppendBuffer(size_t Sequence, Iterable::Queue<char> Buffer, File file = {}, size_t FileLength = 0)
+                {
+                    auto &Item = Slot(Sequence);
 
-                    // Serialize headers
+                    if (Item.Ready)
+                        throw std::logic_error("Request was already answered");
 
-                    for (auto const &[k, v] : Response.Headers)
-                        Ser << k << ": " << v << "\r\n";
+                    Item = OutEntry{};
+                    Item.Buffer = std::move(Buffer);
+                    Item.FilePtr = std::move(file);
+                    Item.FileContentLength = FileLength;
+                }
 
-                    // Handle keep-alive
+                void AppendFile(Connection::Context const &Context, HTTP::Response Response, std::string const &Path)
+                {
+                    File file = File::Open(Path, File::ReadOnly);
 
-                    if (!this->ShouldClose && Response.Version == HTTP::HTTP10)
-                    {
-                        Ser << "connection: keep-alive\r\n";
-                    }
-                    else if (this->ShouldClose && Response.Version == HTTP::HTTP11)
+                    // Siblings are tried with open() alone, a missing one costs one failed syscall
+
+                    if (Setting.Coding && Setting.Coding->Precompressed)
                     {
-                        Ser << "connection: close\r\n";
-                    }
+                        static constexpr std::tuple<uint8_t, char const *, char const *> Siblings[] = {
+                            {Codec::Brotli, ".br", "br"},
+                            {Codec::GZip, ".gz", "gzip"},
+                        };
 
-                    // Calculate length
+                        for (auto [Coding, Extension, Name] : Siblings)
+                        {
+                            if (!(Context.Encodings & Coding))
+                                continue;
 
-                    if (file)
-                    {
-                        FileLength = FileLength ? FileLength : file.BytesLeft();
-                    }
-                    else
-                    {
-                        StringLength = Response.Content.length();
-                    }
+                            int INode = open((Path + Extension).c_str(), File::ReadOnly | File::CloseOnExec);
 
-                    if (Response.Headers.find("content-length") == Response.Headers.end())
-                        Ser << "content-length: " << std::to_string(FileLength + StringLength) << "\r\n";
+                            if (INode < 0)
+                                continue;
 
-                    Response.SetCookies.ForEach(
-                        [&](auto const &Cookie)
-                        {
-                            Ser << "set-cookie: " << Cookie << "\r\n";
-                        });
+                            File Sibling(INode);
 
-                    Ser << "\r\n"
-                        << Response.Content;
+                            // A sibling compressed before the file was last edited is stale
 
-                    AppendBuffer(std::move(Buffer), std::move(file), FileLength);
-                }
-                
-                void operator()(Async::EventLoop::Context &Context, ePoll::Entry &Item)
-                {
-                    Connection::Context ConnContext{Context, Target, Source};
+                            if (!IsFresh(Sibling, file))
+                                continue;
 
-                    if (Item.Happened(ePoll::HangUp) || Item.Happened(ePoll::Error) ||
-                        ((Item.Happened(ePoll::In) || Item.Happened(ePoll::UrgentIn)) && !OnRead(ConnContext)) ||
-                        (Item.Happened(ePoll::Out) && !OnWrite(ConnContext)))
-                    {
-                        Context.Remove();
-                        return;
+                            file = std::move(Sibling);
+
+                            Response.Headers.insert_or_assign("content-encoding", Name);
+                            Codec::AddVary(Response);
+
+                            break;
+                        }
                     }
 
-                    Context.Reschedule(Setting.Timeout);
+                    AppendResponse(Context, Response, std::move(file));
                 }
 
-                bool OnRead(Connection::Context &Context)
+                static bool IsFresh(File const &Sibling, File const &Source)
                 {
-                    Network::Socket &Client = static_cast<Network::Socket &>(Context.Self.File);
+                    struct stat Coded, Original;
 
-                    // @todo Optimize parser by giving it parsing error callbacks so we
-                    // dont need try catch block
-
-                    try
-                    {
-                        Format::Stream Stream(IBuffer);
+                    if (fstat(Sibling.INode(), &Coded) < 0 || fstat(Source.INode(), &Original) < 0)
+                        return false;
 
-                        static constexpr size_t Threshold = 1024 * 2;
-                        size_t Free = Stream.Queue.IsFree();
+                    if (Coded.st_mtim.tv_sec != Original.st_mtim.tv_sec)
+                        return Coded.st_mtim.tv_sec > Original.st_mtim.tv_sec;
 
-                        if (Free < Threshold)
-                            Stream.Queue.IncreaseCapacity(Threshold - Free);
+                    return Coded.st_mtim.tv_nsec >= Original.st_mtim.tv_nsec;
+                }
 
-                        if ((SSL ? SSL.Read(Stream) : Client.Read(Stream)) <= 0)
-                        {
-                            return false;
-                        }
+                void AppendShared(Connection::Context const &Context, HTTP::Response const &Response, std::shared_ptr<File const> file, size_t Offset, size_t Length)
+                {
+                    AppendResponse(Context, Response, {}, Length);
 
-                        Parser();
+                    auto &Item = Slot(Context.Sequence);
 
-                        if (Parser.RequiresContinue100)
-                        {
-                            return Continue100(Context);
-                        }
-                    }
-                    catch (HTTP::Status Method)
-                    {
-                        auto Response = HTTP::Response::From(Parser.Result.Version.empty() ? HTTP10 : Parser.Result.Version, Method, {{"Connection", "close"}}, "");
+                    Item.SharedFile = std::move(file);
+                    Item.FileOffset = static_cast<off_t>(Offset);
+                }
 
-                        if (Setting.OnError)
-                            Setting.OnError(Context, Response);
+                void AppendStream(Connection::Context const &Context, HTTP::Response const &Response)
+                {
+                    auto Buffer = Iterable::Queue<char>(Setting.ResponseBufferSize);
+                    Format::Stream Ser(Buffer);
 
-                        AppendResponse(Response);
+                    // HTTP/1.0 has no chunked coding, the end of the body is the end of the connection
 
-                        Context.ListenFor(ePoll::Out);
+                    bool Chunked = Response.Version != HTTP::HTTP10;
 
+                    if (!Chunked)
                         ShouldClose = true;
 
-                        return true;
-                    }
+                    SerializeHead(Ser, Context, Response);
 
-                    if (!Parser.IsFinished())
-                        return true;
+                    if (Chunked && Response.Headers.find("transfer-encoding") == Response.Headers.end())
+                        Ser << "transfer-encoding: chunked\r\n";
 
-                    // Decide if we should keep the connection
+                    Ser << "\r\n";
+
+                    AppendBuffer(Context.Sequence, std::move(Buffer));
 
-                    auto It = Parser.Result.Headers.find("Connection");
-                    auto End = Parser.Result.Headers.end();
+                    auto &Item = Slot(Context.Sequence);
 
-                    // @todo Optimize this
+                    Item.Open = true;
+                    Item.Chunked = Chunked;
+                }
+
+                /**
+                 * @brief Frames a piece of a streamed response into its slot
+                 * @return False if the slot holds at least the high watermark
+                 */
+                bool AppendChunk(size_t Sequence, std::string_view Data)
+                {
+                    auto &Item = Slot(Sequence);
+
+                    if (!Item.Open)
+                        throw std::logic_error("Response is not streamed");
 
+                    // An empty chunk would end the body
+
+                    if (!Data.empty())
                     {
-                        std::string ConnectionValue;
+                        Format::Stream Ser(Item.Buffer);
 
-                        if (It != End)
+                        if (Item.Chunked)
                         {
-                            // @todo Optimize this
-
-                            ConnectionValue.resize(It->second.length());
-
-                            std::transform(
-                                It->second.begin(),
-                                It->second.end(),
-                                ConnectionValue.begin(),
-                                [](auto c)
-                                {
-                                    return std::tolower(c);
-                                });
-                        }
+                            char Size[sizeof(size_t) * 2];
 
-                        // @todo Optimize this
+                            auto End = std::to_chars(Size, Size + sizeof(Size), Data.length(), 16).ptr;
 
-                        if ((Parser.Result.Version == HTTP::HTTP10 && ConnectionValue != "keep-alive") ||
-                            (Parser.Result.Version == HTTP::HTTP11 && ConnectionValue == "close"))
+                            Ser << std::string_view{Size, static_cast<size_t>(End - Size)} << "\r\n"
+                                << Data << "\r\n";
+                        }
+                        else
                         {
-                            Client.ShutDown(Network::Socket::ShutdownRead);
-                            ShouldClose = true;
+                            Ser << Data;
                         }
                     }
 
-                    Setting.OnRequest(Context, Parser.Result);
-
-                    if (OnReceived)
-                        OnReceived();
+                    if (Item.Buffer.Length() < Setting.HighWatermark)
+                        return true;
 
-                    if (!ShouldClose)
-                        Parser.Reset();
+                    Item.Throttled = true;
 
-                    return true;
+                    return false;
                 }
 
-                bool OnWrite(Connection::Context &Context)
+                void CloseStream(size_t Sequence)
                 {
-                    Network::Socket &Client = static_cast<Network::Socket &>(Context.Self.File);
+                    auto &Item = Slot(Sequence);
 
-                    // If there is nothing to send
+                    if (!Item.Open)
+                        throw std::logic_error("Response is not streamed");
 
-                    if (OBuffer.IsEmpty())
+                    if (Item.Chunked)
                     {
-                        if (ShouldClose)
-                        {
-                            return false;
-                        }
+                        Format::Stream Ser(Item.Buffer);
+
+                        Ser << "0\r\n\r\n";
+                    }
 
-                        OBuffer.Free();
-                        Context.ListenFor(ePoll::In);
+                    Item.Open = false;
+                    Item.OnWritable = nullptr;
+                }
 
-                        if (OnSent)
-                            OnSent();
+                void AppendPrepared(Connection::Context const &Context, HTTP::PreparedResponse const &Prepared, std::string_view Content = {})
+                {
+                    auto Buffer = Iterable::Queue<char>(Prepared.IsTemplate || SSL ? Setting.ResponseBufferSize : 64);
+                    Format::Stream Ser(Buffer);
 
-                        return true;
-                    }
+                    // TLS encrypts into its own records anyway so the whole response is copied once
 
-                    auto &Item = OBuffer.Head();
-                    Format::Stream Stream(Item.Buffer);
+                    if (SSL)
+                        Ser << Prepared.Head();
 
-                    // Send data in buffer
+                    Prepared.SerializeSlots(Ser, Context.Loop.Date(), ConnectionLine(Prepared.Version), Content);
 
-                    if (!Item.Buffer.IsEmpty())
+                    if (SSL)
                     {
-                        // Write data
-
-                        if ((SSL ? SSL.Write(Stream) : Client.Write(Stream)) <= 0)
-                        {
-                            return false;
-                        }
+                        Ser << Prepared.Tail();
 
-                        if (!Item.Buffer.IsEmpty())
-                            return true;
+                        AppendBuffer(Context.Sequence, std::move(Buffer));
+                        return;
                     }
 
-                    // Send file
+                    AppendBuffer(Context.Sequence, std::move(Buffer));
 
-                    if (Item.FileContentLength)
-                    {
-                        if (SSL)
-                            Item.FileContentLength -= SSL.SendFile(Item.FilePtr, Item.FileContentLength);
-                        else
-                            Item.FileContentLength -= Client.SendFile(Item.FilePtr, Item.FileContentLength);
-                    }
+                    auto &Item = OBuffer[Context.Sequence - Retired];
+
+                    Item.Shared = Prepared.Data;
+                    Item.Head = Prepared.Head();
+                    Item.Tail = Prepared.Tail();
+                }
 
-                    // Pop buffer if we're done
+                // Keep-alive line of a response, depends on the version and whether the connection closes
 
-                    if (Item.Buffer.IsEmpty() && !Item.FileContentLength)
-                    {
-                        OBuffer.Take();
-                    }
+                inline std::string_view ConnectionLine(std::string_view Version) const
+                {
+                    if (!ShouldClose && Version == HTTP::HTTP10)
+                        return "connection: keep-alive\r\n";
+
+                    if (ShouldClose && Version == HTTP::HTTP11)
+                        return "connection: close\r\n";
+
+                    return {};
+                }
+
+                inline bool HasReady()
+                {
+                    return !OBuffer.IsEmpty() && OBuffer.Head().IsSendable();
+                }
+
+                // Status line and header lines up to the length of the content
+
+                void SerializeHead(Format::Stream &Ser, Connection::Context const &Context, HTTP::Response const &Response, bool Encoded = false)
+                {
+                    // Serialize first line
+
+                    Ser << "HTTP/" << Response.Version << ' ' << std::to_string(static_cast<unsigned short>(Response.Status)) << ' ' << Response.Brief << "\r\n";
+
+                    // Serialize headers, an encoded response varies on accept-encoding on top of what it already does
+
+                    bool Varies = false;
+
+                    for (auto const &[k, v] : Response.Headers)
+                    {
+                        if (Encoded && EqualsIgnoreCase(k, "vary"))
+                        {
+                            Ser << k << ": " << Codec::Vary(v) << "\r\n";
+                            Varies = true;
+                            continue;
+                        }
+
+                        Ser << k << ": " << v << "\r\n";
+                    }
+
+                    if (Encoded && !Varies)
+                        Ser << "vary: accept-encoding\r\n";
+
+                    // Date is formatted by the loop once per second
+
+                    if (Response.Headers.find("date") == Response.Headers.end())
+                        Ser << "date: " << Context.Loop.Date() << "\r\n";
+
+                    // Handle keep-alive
+
+                    Ser << ConnectionLine(Response.Version);
+
+                    Response.SetCookies.ForEach(
+                        [&](auto const &Cookie)
+                        {
+                            Ser << "set-cookie: " << Cookie << "\r\n";
+                        });
+                }
+
+                void AppendResponse(Connection::Context const &Context, HTTP::Response const &Response, File file = {}, size_t FileLength = 0)
+                {
+                    size_t StringLength = 0;
+                    auto Buffer = Iterable::Queue<char>(Setting.ResponseBufferSize);
+                    Format::Stream Ser(Buffer);
+
+                    std::string_view Content = Response.Content;
+
+                    // Textual content is compressed by the loop's encoder into its scratch buffer
+
+                    bool Encoded = !file && !FileLength && (Context.Encodings & Codec::GZip) && Setting.Coding && Setting.Coding->ShouldEncode(Response);
+
+                    SerializeHead(Ser, Context, Response, Encoded);
+
+                    if (Encoded)
+                    {
+                        auto &Scratch = Codec::Scratch();
+
+                        Scratch.Free();
+                        Setting.Coding->Encode(Content, Scratch, Setting.Coding->Level);
+
+                        Content = {Scratch.Content(), Scratch.Length()};
+
+                        Ser << "content-encoding: gzip\r\n";
+                    }
+
+                    // Calculate length
+
+                    if (file)
+                    {
+                        FileLength = FileLength ? FileLength : file.BytesLeft();
+                    }
+                    else
+                    {
+                        StringLength = Content.length();
+                    }
+
+                    if (Response.Headers.find("content-length") == Response.Headers.end())
+                        Ser << "content-length: " << std::to_string(FileLength + StringLength) << "\r\n";
+
+                    Ser << "\r\n"
+                        << Content;
+
+                    AppendBuffer(Context.Sequence, std::move(Buffer), std::move(file), FileLength);
+                }
+                
+                void operator()(Async::EventLoop::Context &Context, ePoll::Entry &Item)
+                {
+                    Connection::Context ConnContext{Context, Target, Source};
+
+                    // A peer that went away fails reads and writes with an exception, the
+                    // connection is then dropped like on EPOLLERR
+
+                    bool Result = false;
+
+                    try
+                    {
+                        Result = Setting.EdgeTriggered ? OnEdge(ConnContext, Item) : OnLevel(ConnContext, Item);
+                    }
+                    catch (std::system_error const &)
+                    {
+                        Dispatching = false;
+                    }
+
+                    if (!Result)
+                    {
+                        Context.Remove();
+                        return;
+                    }
+
+                    Context.Touch();
+                }
+
+                bool OnLevel(Connection::Context &Context, ePoll::Entry &Item)
+                {
+                    if (Dropped || Item.Happened(ePoll::HangUp) || Item.Happened(ePoll::Error))
+                        return false;
+
+                    if (IsReading() && (Item.Happened(ePoll::In) || Item.Happened(ePoll::UrgentIn)))
+                    {
+                        Dispatching = true;
+
+                        bool Result = OnRead(Context);
+
+                        Dispatching = false;
+
+                        if (!Result)
+                            return false;
+
+                        return Drain(Context);
+                    }
+
+                    if (Item.Happened(ePoll::Out) && !OnWrite(Context))
+                        return false;
+
+                    return true;
+                }
+
+                // Level triggered mode only asks epoll again when the interest changes
+
+                inline void Listen(Connection::Context const &Context, ePoll::Event Events)
+                {
+                    if (Events == Listening)
+                        return;
+
+                    Context.ListenFor(Events);
+                    Listening = Events;
+                }
+
+                /**
+                 * @brief Events to wait for in level triggered mode
+                 * Writability is only asked for while the head slot is ready, a closing
+                 * connection or a paused body waits for nothing but its pending responses
+                 */
+                inline ePoll::Event LevelEvents()
+                {
+                    ePoll::Event Events = IsReading() && !Parser.Paused ? ePoll::In : ePoll::HangUp;
+
+                    return HasReady() ? Events | ePoll::Out : Events;
+                }
+
+                bool OnEdge(Connection::Context &Context, ePoll::Entry &Item)
+                {
+                    if (Dropped || Item.Happened(ePoll::HangUp) || Item.Happened(ePoll::Error))
+                        return false;
+
+                    if (Item.Happened(ePoll::Out))
+                        Writable = true;
+
+                    // Responses produced while handling requests are flushed once at the end
+
+                    // Reading side is shut down once the connection is closing
+
+                    if (IsReading() && (Item.Happened(ePoll::In) || Item.Happened(ePoll::UrgentIn) || Item.Happened(ePoll::ReadHangUp)))
+                    {
+                        Dispatching = true;
+
+                        bool Result = OnRead(Context);
+
+                        Dispatching = false;
+
+                        if (!Result)
+                            return false;
+                    }
+
+                    if (Writable && !OBuffer.IsEmpty() && !OnWrite(Context))
+                        return false;
+
+                    return true;
+                }
+
+                // A closing connection still reads the rest of a streamed body
+
+                inline bool IsReading()
+                {
+                    return !ShouldClose || (Dispatched && !Parser.IsFinished());
+                }
+
+                /**
+                 * @brief Writes what a batch of requests produced
+                 * The socket is only polled for writability in level triggered mode if it would block
+                 */
+                bool Drain(Connection::Context &Context)
+                {
+                    if (Setting.EdgeTriggered)
+                        return !Writable || !HasReady() || OnWrite(Context);
+
+                    if (HasReady())
+                        return OnWrite(Context);
+
+                    Listen(Context, LevelEvents());
+
+                    return true;
+                }
+
+                /**
+                 * @brief Continues a streamed body paused by its handler, see Context::ResumeBody()
+                 * What was buffered is handed over first, edge triggered mode then reads the
+                 * socket since no new event reports data that came in while paused
+                 */
+                void Resume(Connection::Context const &Context)
+                {
+                    if (!Parser.Paused)
+                        return;
+
+                    Parser.Paused = false;
+
+                    auto Copy = Context;
+
+                    Dispatching = true;
+
+                    int Result = -1;
+
+                    try
+                    {
+                        Result = Process(Copy);
+
+                        if (Result > 0 && Setting.EdgeTriggered)
+                            Result = OnRead(Copy) ? 1 : -1;
+
+                        Dispatching = false;
+
+                        if (Result >= 0 && Drain(Copy))
+                            return;
+                    }
+                    catch (std::system_error const &)
+                    {
+                        Dispatching = false;
+                    }
+
+                    // Same as in Flush(), the loop removes the connection at its next event
+
+                    Dropped = true;
+                    Context.ListenFor(Setting.EdgeTriggered ? EdgeEvents : ePoll::In | ePoll::Out);
+                }
+
+                /**
+                 * @brief Called after appending to OBuffer
+                 * Nothing is sent while requests are being dispatched, level triggered
+                 * mode waits for EPOLLOUT and edge triggered mode writes right away
+                 * when the socket is known to be writable
+                 */
+                void Flush(Connection::Context const &Context)
+                {
+                    if (Dispatching || !HasReady())
+                        return;
+
+                    if (!Setting.EdgeTriggered)
+                    {
+                        Listen(Context, LevelEvents());
+                        return;
+                    }
+
+                    if (!Writable)
+                        return;
+
+                    auto Copy = Context;
+                    bool Result = false;
+
+                    try
+                    {
+                        Result = OnWrite(Copy);
+                    }
+                    catch (std::system_error const &)
+                    {
+                    }
+
+                    if (!Result)
+                    {
+                        // Removing here is not safe, re-arming makes epoll report the socket
+                        // again so operator() can remove it
+
+                        Dropped = true;
+                        Context.ListenFor(EdgeEvents);
+                    }
+                }
+
+                /**
+                 * @brief Reads what is available into IBuffer
+                 * @return -1 on end of stream or error, 0 if socket is drained
+                 * and 1 if buffered size limit was reached before draining
+                 */
+                int Fill(Connection::Context &Context)
+                {
+                    Network::Socket &Client = static_cast<Network::Socket &>(Context.Self.File);
+
+                    static constexpr size_t Threshold = 1024 * 2;
+
+                    size_t Limit = (Setting.MaxHeaderSize && Setting.MaxBodySize) ? Setting.MaxHeaderSize + Setting.MaxBodySize + Threshold : 0;
+
+                    size_t Received = 0;
+
+                    do
+                    {
+                        IBuffer.IncreaseCapacity(Threshold);
+
+                        auto Result = SSL ? SSL.Read(IBuffer) : Client.Read(IBuffer);
+
+                        if (Result < 0)
+                        {
+                            if (!Received || !Setting.EdgeTriggered)
+                                return -1;
+
+                            // Peer is done sending, serve what it sent and then close
+
+                            ShouldClose = true;
+                            return 0;
+                        }
+
+                        if (Result == 0)
+                            return Setting.EdgeTriggered ? 0 : -1;
+
+                        Received += Result;
+
+                        if (Setting.EdgeTriggered && Limit && IBuffer.Length() > Limit)
+                            return 1;
+
+                    } while (Setting.EdgeTriggered);
+
+                    return 0;
+                }
+
+                bool OnRead(Connection::Context &Context)
+                {
+                    // Socket is left alone while the handler of a streamed body catches up
+
+                    if (Parser.Paused)
+                        return true;
+
+                    int Filled = 0;
+
+                    do
+                    {
+                        if ((Filled = Fill(Context)) < 0)
+                            return false;
+
+                        int Result = Process(Context);
+
+                        if (Result <= 0)
+                            return Result == 0;
+
+                    } while (Filled > 0);
+
+                    return true;
+                }
+
+                /**
+                 * @brief Handles every complete request in IBuffer, a pipelining client
+                 * sends no more data to trigger another event
+                 * @return -1 to drop the connection, 0 to stop reading and 1 if more data is needed
+                 */
+                int Process(Connection::Context &Context)
+                {
+                    Network::Socket &Client = static_cast<Network::Socket &>(Context.Self.File);
+
+                    while (true)
+                    {
+                        if (Parser.Paused)
+                            return 0;
+
+                        // @todo Optimize parser by giving it parsing error callbacks so we
+                        // dont need try catch block
+
+                        try
+                        {
+                            Parser();
+
+                            if (Parser.RequiresContinue100)
+                            {
+                                Parser.RequiresContinue100 = false;
+
+                                if (!Continue100(Context))
+                                    return -1;
+                            }
+                        }
+                        catch (HTTP::Status Method)
+                        {
+                            auto Response = HTTP::Response::From(Parser.Result.View.Version.empty() ? HTTP10 : Parser.Result.View.Version, Method, {{"Connection", "close"}}, "");
+
+                            if (Setting.OnError)
+                                Setting.OnError(Context, Response);
+
+                            // Slot of a streamed request that failed in its body belongs to its handler
+
+                            if (Dispatched)
+                                return -1;
+
+                            Context.Sequence = Reserve();
+
+                            AppendResponse(Context, Response);
+
+                            ShouldClose = true;
+
+                            return 0;
+                        }
+
+                        // Streamed requests go to the handler as soon as their head is complete
+
+                        if (!Dispatched && (Parser.IsFinished() || Parser.HeadDone))
+                        {
+                            Dispatch(Context);
+
+                            if (!Parser.IsFinished())
+                                continue;
+                        }
+
+                        if (!Parser.IsFinished())
+                            return 1;
+
+                        if (BodyEnd)
+                        {
+                            auto End = std::move(BodyEnd);
+
+                            End();
+                        }
+
+                        if (ShouldClose)
+                        {
+                            Client.ShutDown(Network::Socket::ShutdownRead);
+
+                            // Nothing is left to write that would close the connection later
+
+                            return OBuffer.IsEmpty() ? -1 : 0;
+                        }
+
+                        Parser.Reset();
+                        Dispatched = false;
+
+                        if (IBuffer.IsEmpty())
+                            return 1;
+                    }
+                }
+
+                void Dispatch(Connection::Context &Context)
+                {
+                    // Decide if we should keep the connection
+
+                    auto ConnectionValue = Parser.Result.View.Header("connection");
+                    auto Version = Parser.Result.View.Version;
+
+                    if ((Version == HTTP::HTTP10 && !EqualsIgnoreCase(ConnectionValue, "keep-alive")) ||
+                        (Version == HTTP::HTTP11 && EqualsIgnoreCase(ConnectionValue, "close")))
+                    {
+                        ShouldClose = true;
+                    }
+
+                    Context.Sequence = Reserve();
+                    Context.Encodings = Setting.Coding ? Codec::Accepted(Parser.Result.View.Header("accept-encoding")) : static_cast<uint8_t>(Codec::Identity);
+                    Dispatched = true;
+
+                    Setting.OnRequest(Context, Parser.Result);
+
+                    if (OnReceived)
+                        OnReceived();
+                }
+
+                /**
+                 * @brief Sends the buffers of the ready slots at the head with one writev
+                 * Gathering stops at a slot that still has a file to send, since the
+                 * file has to follow its own head. That head is sent with MSG_MORE so
+                 * it leaves in the same segment as the start of the file. A peer that
+                 * reset fails the send with EPIPE instead of raising SIGPIPE
+                 * @return Written bytes or 0 if the socket would block
+                 */
+                ssize_t WriteGathered(Network::Socket &Client)
+                {
+                    struct iovec Vectors[IOV_MAX];
+                    size_t Count = 0;
+                    int Flags = Network::Socket::NoSignal;
+
+                    for (size_t i = 0; i < OBuffer.Length() && Count + 4 <= IOV_MAX; i++)
+                    {
+                        auto &Item = OBuffer[i];
+
+                        if (!Item.Ready)
+                            break;
+
+                        Count += Item.DataVectors(Vectors + Count);
+
+                        // Chunks written later to an open stream go before the slots behind it
+
+                        if (Item.Open)
+                            break;
+
+                        if (Item.FileContentLength)
+                        {
+                            Flags |= Network::Socket::More;
+                            break;
+                        }
+                    }
+
+                    ssize_t Result = Client.Send(Vectors, Count, Flags);
+
+                    // Consume what was written from the slots in order
+
+                    size_t Left = Result;
+
+                    for (size_t i = 0; Left; i++)
+                        Left -= OBuffer[i].Consume(Left);
+
+                    return Result;
+                }
+
+                /**
+                 * @brief Lets the writer of a throttled stream write again
+                 * Writes made by the callback are sent by the running write loop
+                 * @return True if the callback was called
+                 */
+                bool Drained(OutEntry &Item)
+                {
+                    if (!Item.Open || !Item.Throttled || Item.Buffer.Length() > Setting.LowWatermark)
+                        return false;
+
+                    Item.Throttled = false;
+
+                    if (!Item.OnWritable)
+                        return false;
+
+                    // Callback is moved out so ending the stream from it does not destroy it while it runs
+
+                    auto Callback = std::move(Item.OnWritable);
+                    bool Batching = Dispatching;
+
+                    Dispatching = true;
+
+                    Callback();
+
+                    Dispatching = Batching;
+
+                    if (Item.Open && !Item.OnWritable)
+                        Item.OnWritable = std::move(Callback);
+
+                    return true;
+                }
+
+                /**
+                 * @brief Sends from the file of a slot
+                 * With kernel TLS sending the kernel encrypts what sendfile sends. Without
+                 * it a piece of the file is read into the slot's buffer and encrypted from
+                 * there, that piece is reported as sent.
+                 * @return Sent bytes or 0 if the socket would block
+                 */
+                size_t SendFile(Network::Socket &Client, OutEntry &Item)
+                {
+                    File const &Source = Item.SharedFile ? *Item.SharedFile : Item.FilePtr;
+
+                    if (SSL && !SSL.KernelSend)
+                    {
+                        if (Item.FileOffset < 0)
+                            Item.FileOffset = static_cast<off_t>(Source.Offset());
+
+                        size_t Length = std::min(Item.FileContentLength, FileChunk);
+
+                        Item.Buffer.Free();
+                        Item.Buffer.IncreaseCapacity(Length);
+
+                        auto [Pointer, Size] = Item.Buffer.EmptyChunk();
+
+                        ssize_t Result = pread(Source.INode(), Pointer, std::min(Length, Size), Item.FileOffset);
+
+                        // A file that shrank under its response can not be finished
+
+                        if (Result <= 0)
+                            throw std::system_error(Result < 0 ? errno : EIO, std::generic_category());
+
+                        Item.Buffer.AdvanceTail(Result);
+                        Item.FileOffset += Result;
+                        Item.FileContentLength -= Result;
+
+                        return Result;
+                    }
+
+                    size_t Sent = 0;
+
+                    if (Item.FileOffset >= 0)
+                        Sent = Source.SendFile(Client, Item.FileContentLength, Item.FileOffset);
+                    else
+                        Sent = Client.SendFile(Source, Item.FileContentLength);
+
+                    if (Item.FileOffset >= 0)
+                        Item.FileOffset += Sent;
+
+                    Item.FileContentLength -= Sent;
+
+                    return Sent;
+                }
+
+                // Socket would block, writing goes on at the next EPOLLOUT
+
+                inline bool Blocked(Connection::Context &Context)
+                {
+                    Writable = false;
+
+                    if (!Setting.EdgeTriggered)
+                        Listen(Context, LevelEvents());
+
+                    return true;
+                }
+
+                bool OnWrite(Connection::Context &Context)
+                {
+                    Network::Socket &Client = static_cast<Network::Socket &>(Context.Self.File);
+
+                    // Keeps writing until the ready slots are sent or the socket would block
+
+                    while (!OBuffer.IsEmpty() && OBuffer.Head().Ready)
+                    {
+                        auto &Item = OBuffer.Head();
+
+                        // Send data in buffer
+
+                        if (Item.HasData())
+                        {
+                            ssize_t Result = 0;
+
+                            if (SSL)
+                            {
+                                Format::Stream Stream(Item.Buffer);
+
+                                Result = SSL.Write(Stream);
+                            }
+                            else
+                            {
+                                Result = WriteGathered(Client);
+                            }
+
+                            if (Result < 0)
+                                return false;
+
+                            if (Result == 0)
+                                return Blocked(Context);
+
+                            if (Drained(Item) || Item.HasData())
+                                continue;
+                        }
+
+                        // Send file
+
+                        if (Item.FileContentLength)
+                        {
+                            size_t Sent = SendFile(Client, Item);
+
+                            // Pieces read for user space TLS are sent from the buffer
+
+                            if (Item.HasData() || (Sent && Item.FileContentLength))
+                                continue;
+
+                            if (Item.FileContentLength)
+                                return Blocked(Context);
+                        }
+
+                        // Open stream waits for its writer
+
+                        if (Item.Open)
+                        {
+                            if (Drained(Item))
+                                continue;
+
+                            break;
+                        }
+
+                        // Pop the slot, it is done
+
+                        OBuffer.Take();
+                        Retired++;
+                    }
+
+                    // Slots of requests still being handled are sent once they are ready
+
+                    if (!OBuffer.IsEmpty())
+                    {
+                        if (!Setting.EdgeTriggered)
+                            Listen(Context, LevelEvents());
+
+                        return true;
+                    }
+
+                    // Nothing left to send
+
+                    if (ShouldClose && !IsReading())
+                    {
+                        return false;
+                    }
+
+                    OBuffer.Free();
+
+                    if (!Setting.EdgeTriggered)
+                        Listen(Context, LevelEvents());
+
+                    if (OnSent)
+                        OnSent();
 
                     return true;
                 }
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Format/GZip.hpp>
+#include <Network/HTTP/Codec.hpp>
+
+namespace Core::Network::HTTP::Modules
+{
+    /**
+     * @brief Response compression and request decoding for the router module
+     * Textual responses are gzipped for clients that accept it, gzip request
+     * content is decoded before it reaches the handlers and files sent with
+     * Context::SendFile() are swapped for precompressed siblings. Every loop
+     * reuses its own zlib streams. Needs zlib, which the CMake target links.
+     */
+    template <typename T>
+    class Compression
+    {
+    public:
+        Compression()
+        {
+            _Codec.Encode = &Encode;
+            _Codec.Decode = &Decode;
+        }
+
+        inline T &Compress(bool Enable)
+        {
+            return static_cast<T &>(*this).Coding(Enable ? &_Codec : nullptr);
+        }
+
+        /**
+         * @brief zlib level from 1 to 9, higher levels cost more time for smaller output
+         */
+        inline T &CompressionLevel(int Level)
+        {
+            _Codec.Level = Level;
+            return static_cast<T &>(*this);
+        }
+
+        // Content smaller than this is sent as is
+
+        inline T &MinCompressSize(size_t Size)
+        {
+            _Codec.MinSize = Size;
+            return static_cast<T &>(*this);
+        }
+
+        // Looks for .br and .gz siblings of files sent with Context::SendFile() or served by Modules::Static,
+        // a sibling older than its file is not sent
+
+        inline T &Precompressed(bool Enable)
+        {
+            _Codec.Precompressed = Enable;
+            return static_cast<T &>(*this);
+        }
+
+        inline T &CompressResponses(bool Enable)
+        {
+            _Codec.Encode = Enable ? &Encode : nullptr;
+            return static_cast<T &>(*this);
+        }
+
+        inline T &DecompressRequests(bool Enable)
+        {
+            _Codec.Decode = Enable ? &Decode : nullptr;
+            return static_cast<T &>(*this);
+        }
+
+    private:
+        HTTP::Codec _Codec;
+
+        static void Encode(std::string_view Content, Iterable::Buffer<char> &Output, int Level)
+        {
+            Format::GZip::Deflater(Level).Run(Content, Output);
+        }
+
+        static void Decode(std::string_view Content, Iterable::Buffer<char> &Output, size_t Limit)
+        {
+            Format::GZip::Inflater().Run(Content, Output, Limit);
+        }
+    };
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <tuple>
+#include <exception>
+#include <system_error>
 #include <netinet/tcp.h>
 
 #include <Duration.hpp>
@@ -9,6 +13,7 @@
 #include <Network/HTTP/Request.hpp>
 #include <Async/ThreadPool.hpp>
 #include <Network/HTTP/Router.hpp>
+#include <Network/HTTP/Pipeline.hpp>
 #include <Network/HTTP/Connection.hpp>
 
 namespace Core::Network::HTTP::Modules
@@ -99,6 +104,27 @@ namespace Core::Network::HTTP::Modules
                 std::forward<TAction>(Action));
         }
 
+        /**
+         * @brief Runs requests through middleware layers composed at compile time
+         * Layers are called in order as Layer(Context, Request, Next) and the last one
+         * hands over to the routes, only the entry of the chain is type erased.
+         * Replaces the request path, so runtime middlewares have to be added after it.
+         */
+        template <typename... TLayers>
+        inline T &Pipeline(TLayers &&...Layers)
+        {
+            Settings.OnRequest = HTTP::Pipeline(
+                [this](Connection::Context &Context, Network::HTTP::Request &Request)
+                {
+                    _Router.Match(Request.View.Target, Request.View.Method, Context, Request);
+                },
+                std::forward<TLayers>(Layers)...);
+
+            return static_cast<T &>(*this);
+        }
+
+        // Runtime middleware, each layer adds one type erased call
+
         template <typename TCallback>
         inline T &Middleware(TCallback &&Callback)
         {
@@ -183,39 +209,94 @@ namespace Core::Network::HTTP::Modules
             return static_cast<T &>(*this);
         }
 
-        inline auto &Listen(Network::EndPoint const &endPoint)
+        /**
+         * @brief Registers connections edge triggered once and reads and
+         * writes until EAGAIN, so no epoll_ctl is needed per response
+         */
+        inline T &EdgeTriggered(bool Enable)
         {
-            return static_cast<T &>(*this).ListenWith(
-                endPoint,
-                [this, endPoint, Counter = 0ull](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
-                {
-                    Network::Socket &Router = static_cast<Network::Socket &>(Context.Self.File);
+            Settings.EdgeTriggered = Enable;
+            return static_cast<T &>(*this);
+        }
 
-                    auto [Client, Info] = Router.Accept();
+        /**
+         * @brief Hands requests to handlers without copying them out of the input buffer
+         * Only Request.View is filled, its fields are valid until the handler returns
+         */
+        inline T &ZeroCopy(bool Enable)
+        {
+            Settings.ZeroCopy = Enable;
+            return static_cast<T &>(*this);
+        }
 
-                    if (!Client || !static_cast<T &>(*this).TryIncrementConnectionCount())
-                        return;
+        /**
+         * @brief Calls handlers once the head of a request is in, the body is then
+         * received through Context::OnBodyChunk() and is not limited by the body size
+         */
+        inline T &StreamBody(bool Enable)
+        {
+            Settings.StreamBody = Enable;
+            return static_cast<T &>(*this);
+        }
 
-                    // Set Non-blocking
+        /**
+         * @brief Bounds the queued data of a streamed response
+         * @param High SendChunk() returns false once this much is queued
+         * @param Low OnWritable() is called once the queue is sent down to this
+         */
+        inline T &Watermarks(size_t High, size_t Low)
+        {
+            Settings.HighWatermark = High;
+            Settings.LowWatermark = Low;
+            return static_cast<T &>(*this);
+        }
 
-                    Client.Blocking(false);
+        // Content codings of the connections, set up by Modules::Compression
 
-                    // Set NoDelay
+        inline T &Coding(HTTP::Codec const *Value)
+        {
+            Settings.Coding = Value;
+            return static_cast<T &>(*this);
+        }
 
-                    if (Settings.NoDelay)
-                        Client.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+        /**
+         * @brief Stateless session tickets of HTTPS listeners added after this call
+         * @param Rotation Tickets are sealed with a new key this often, tickets of the
+         * key before it are still accepted
+         */
+        inline T &SessionTickets(bool Enable, Duration const &Rotation = {3600, 0})
+        {
+            Resumption.Tickets = Enable;
+            Resumption.TicketRotation = Rotation;
+            return static_cast<T &>(*this);
+        }
 
-                    static_cast<T &>(*this).ThreadPool()[Counter].Assign(
-                        std::move(Client),
-                        Connection(Info, endPoint, Settings),
-                        // Async::EventLoop::CallbackType::From<Connection>(Info, endPoint, Settings),
-                        [this]
-                        {
-                            static_cast<T &>(*this).DecrementConnectionCount();
-                        },
-                        Settings.Timeout);
+        /**
+         * @brief Session cache shared by the loops for HTTPS listeners added after this call
+         * @param Size Sessions kept, 0 turns the cache off
+         */
+        inline T &SessionCache(size_t Size, Duration const &Lifetime = {7200, 0})
+        {
+            Resumption.CacheSize = Size;
+            Resumption.Lifetime = Lifetime;
+            return static_cast<T &>(*this);
+        }
 
-                    Counter = static_cast<T &>(*this).ThreadPool().Length() ? (Counter + 1) % static_cast<T &>(*this).ThreadPool().Length() : 0;
+        inline auto &Listen(Network::EndPoint const &endPoint)
+        {
+            return static_cast<T &>(*this).ListenWith(
+                endPoint,
+                [this, endPoint, Counter = static_cast<size_t>(0), ListenerNoDelay = false](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
+                {
+                    AcceptAll(
+                        Context,
+                        Counter,
+                        ListenerNoDelay,
+                        false,
+                        [&](Network::Socket &, Network::EndPoint const &Info) -> Async::EventLoop::CallbackType
+                        {
+                            return Connection(Info, endPoint, Settings);
+                        });
                 },
                 nullptr);
         }
@@ -224,85 +305,162 @@ namespace Core::Network::HTTP::Modules
         {
             return static_cast<T &>(*this).ListenWith(
                 endPoint,
-                [this, endPoint, Counter = 0ull, TLS = TLSContext(Certification, Key)](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
+                [this, endPoint, Counter = static_cast<size_t>(0), ListenerNoDelay = false, TLS = std::make_shared<TLSContext>(Certification, Key, Resumption)](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
                 {
-                    Network::Socket &Router = static_cast<Network::Socket &>(Context.Self.File);
+                    AcceptAll(
+                        Context,
+                        Counter,
+                        ListenerNoDelay,
+                        true,
+                        [&](Network::Socket &Client, Network::EndPoint const &Info) -> Async::EventLoop::CallbackType
+                        {
+                            // The tls ULP is set up by OpenSSL once the handshake has the keys, see TLSContext::KernelTLS()
 
-                    auto [Client, Info] = Router.Accept();
+                            auto SS = TLS->NewSocket();
 
-                    if (!Client || !static_cast<T &>(*this).TryIncrementConnectionCount())
-                        return;
+                            SS.SetDescriptor(Client);
+                            SS.SetAccept();
+                            // SS.SetVerify(SSL_VERIFY_NONE, nullptr);
 
-                    // Set Non-blocking
+                            return [this, endPoint, Info = Info, SSL = std::move(SS)](Async::EventLoop::Context &Context, ePoll::Entry &Item) mutable
+                            {
+                                if (Item.Happened(ePoll::HangUp) || Item.Happened(ePoll::Error))
+                                {
+                                    Context.Remove();
+                                    return;
+                                }
+
+                                //
+
+                                auto Result = SSL.Handshake();
+
+                                if (Result == 1)
+                                {
+                                    SSL.ShakeHand = true;
+                                    Context.ListenFor(ePoll::In);
+                                    // Context.Upgrade(Async::EventLoop::CallbackType::From<Connection>(Info, endPoint, Settings, std::move(SSL)), Settings.Timeout);
+                                    Context.Upgrade(Connection(Info, endPoint, Settings, std::move(SSL)), Settings.Timeout, Settings.EdgeTriggered ? Connection::EdgeEvents : ePoll::In);
+                                    return;
+                                }
+
+                                auto Error = SSL.GetError(Result);
+
+                                if (Error == SSL_ERROR_WANT_WRITE)
+                                {
+                                    Context.ListenFor(ePoll::Out | ePoll::In);
+                                }
+                                else if (Error == SSL_ERROR_WANT_READ)
+                                {
+                                    Context.ListenFor(ePoll::In);
+                                }
+                                else
+                                {
+                                    Context.Remove();
+                                }
+                            };
+                        });
+                },
+                nullptr);
+        }
 
-                    Client.Blocking(false);
+    private:
+        /**
+         * @brief Drains the listener's backlog until EAGAIN and hands
+         * the accepted clients to their loops with one enqueue per loop
+         * @param Builder Makes the connection handler for each client
+         */
+        template <typename TBuilder>
+        void AcceptAll(Async::EventLoop::Context &Context, size_t &Counter, bool &ListenerNoDelay, bool IsSecure, TBuilder &&Builder)
+        {
+            auto &Self = static_cast<T &>(*this);
+            auto &Pool = Self.ThreadPool();
+            Network::Socket &Listener = static_cast<Network::Socket &>(Context.Self.File);
 
-                    // Set NoDelay
+            // Accepted sockets inherit TCP_NODELAY from the listener,
+            // so only clients of this round need it set on their own
 
-                    if (Settings.NoDelay)
-                        Client.SetOptions(IPPROTO_TCP, TCP_NODELAY, 1);
+            bool SetNoDelay = Settings.NoDelay && !ListenerNoDelay;
 
-                    // #ifdef TLS_1_2_VERSION
-                    // if (true /*Settings.KernelTLS*/)
-                    //     Client.SetOptions(SOL_TCP, TCP_ULP, "tls");
-                    // #endif
+            if (SetNoDelay)
+            {
+                Listener.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+                ListenerNoDelay = true;
+            }
 
-                    auto SS = TLS.NewSocket();
+            bool PerLoop = Self.ListensPerLoop();
+            ePoll::Event Events = Settings.EdgeTriggered && !IsSecure ? Connection::EdgeEvents : ePoll::In;
+            size_t Count = PerLoop || !Pool.Length() ? 1 : Pool.Length();
 
-                    SS.SetDescriptor(Client);
-                    SS.SetAccept();
-                    // SS.SetVerify(SSL_VERIFY_NONE, nullptr);
+            Iterable::List<Async::EventLoop::AssignmentList> Batches(Count);
 
-                    static_cast<T &>(*this).ThreadPool()[Counter].Assign(
-                        std::move(Client),
-                        [this, endPoint, Info = Info, SSL = std::move(SS)](Async::EventLoop::Context &Context, ePoll::Entry &Item) mutable
-                        {
-                            if (Item.Happened(ePoll::HangUp) || Item.Happened(ePoll::Error))
-                            {
-                                Context.Remove();
-                                return;
-                            }
+            for (size_t i = 0; i < Count; i++)
+                Batches.Add();
 
-                            //
+            std::exception_ptr Failure;
 
-                            auto Result = SSL.Handshake();
+            while (true)
+            {
+                Network::Socket Client;
+                Network::EndPoint Info;
 
-                            if (Result == 1)
-                            {
-                                SSL.ShakeHand = true;
-                                Context.ListenFor(ePoll::In);
-                                // Context.Upgrade(Async::EventLoop::CallbackType::From<Connection>(Info, endPoint, Settings, std::move(SSL)), Settings.Timeout);
-                                Context.Upgrade(Connection(Info, endPoint, Settings, std::move(SSL)), Settings.Timeout);
-                                return;
-                            }
+                try
+                {
+                    std::tie(Client, Info) = Listener.Accept(Network::Socket::NonBlocking | Network::Socket::CloseExec);
+                }
+                catch (std::system_error const &Error)
+                {
+                    // A client that left the backlog is skipped, running out of descriptors
+                    // or memory ends the round and the clients taken so far are still handed over
 
-                            auto Error = SSL.GetError(Result);
+                    int Code = Error.code().value();
 
-                            if (Error == SSL_ERROR_WANT_WRITE)
-                            {
-                                Context.ListenFor(ePoll::Out | ePoll::In);
-                            }
-                            else if (Error == SSL_ERROR_WANT_READ)
-                            {
-                                Context.ListenFor(ePoll::In);
-                            }
-                            else
-                            {
-                                Context.Remove();
-                            }
-                        },
-                        [this]
-                        {
-                            static_cast<T &>(*this).DecrementConnectionCount();
-                        },
-                        Settings.Timeout);
+                    if (Code == ECONNABORTED || Code == EINTR)
+                        continue;
 
-                    Counter = static_cast<T &>(*this).ThreadPool().Length() ? (Counter + 1) % static_cast<T &>(*this).ThreadPool().Length() : 0;
-                },
-                nullptr);
+                    if (Code != EMFILE && Code != ENFILE && Code != ENOBUFS && Code != ENOMEM)
+                        Failure = std::current_exception();
+
+                    break;
+                }
+
+                if (!Client)
+                    break;
+
+                if (!Self.TryIncrementConnectionCount())
+                    continue;
+
+                if (SetNoDelay)
+                    Client.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+
+                auto Callback = Builder(Client, Info);
+
+                Batches[Count == 1 ? 0 : Counter].Add(
+                    std::move(Client),
+                    std::move(Callback),
+                    [this]
+                    {
+                        static_cast<T &>(*this).DecrementConnectionCount();
+                    },
+                    Settings.Timeout,
+                    Events);
+
+                Counter = Count == 1 ? 0 : (Counter + 1) % Count;
+            }
+
+            for (size_t i = 0; i < Count; i++)
+            {
+                if (!Batches[i].Length())
+                    continue;
+
+                auto &Loop = PerLoop ? Context.Loop : Pool[i];
+
+                Loop.Assign(std::move(Batches[i]));
+            }
+
+            if (Failure)
+                std::rethrow_exception(Failure);
         }
 
-    private:
         Connection::Settings Settings{
             1024 * 1024 * 1,
             1024 * 1024 * 5,
@@ -311,19 +469,27 @@ namespace Core::Network::HTTP::Modules
             nullptr,
             [this](Connection::Context &Context, Network::HTTP::Request &Request)
             {
-                _Router.Match(Request.Path, Request.Method, Context, Request);
+                _Router.Match(Request.View.Target, Request.View.Method, Context, Request);
             },
             false,
             false,
-            {5, 0}};
+            {5, 0},
+            false,
+            false,
+            false,
+            1024 * 64,
+            1024 * 16};
 
         ::Router<void(HTTP::Connection::Context &, HTTP::Request &)> _Router;
 
+        TLSSessions::Options Resumption;
+
         static void DefaultRoute(HTTP::Connection::Context &Context, HTTP::Request &Req)
         {
-            auto static Response = HTTP::Response::HTML(Req.Version, HTTP::Status::NotFound, "<h1>404 Not Found</h1>");
+            static HTTP::PreparedResponse const NotFound10(HTTP::Response::HTML(HTTP::HTTP10, HTTP::Status::NotFound, "<h1>404 Not Found</h1>"));
+            static HTTP::PreparedResponse const NotFound11(HTTP::Response::HTML(HTTP::HTTP11, HTTP::Status::NotFound, "<h1>404 Not Found</h1>"));
 
-            Context.SendResponse(Response);
+            Context.SendResponse(Req.View.Version == HTTP::HTTP10 ? NotFound10 : NotFound11);
         }
     };
 }
\ No newline at end of file
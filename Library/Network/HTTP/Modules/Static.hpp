@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include <Network/HTTP/StaticFiles.hpp>
+
+namespace Core::Network::HTTP::Modules
+{
+    /**
+     * @brief Static file routes for the router module, see HTTP::StaticFiles
+     */
+    template <typename T>
+    class Static
+    {
+    public:
+        /**
+         * @brief Serves the files under Root for GET and HEAD requests below TRoute
+         * Requests for missing files are answered with 404
+         * @param MemoryLimit Files up to this size are kept in memory
+         */
+        template <ctll::fixed_string TRoute>
+        inline T &Serve(std::string Root, size_t MemoryLimit = 1024 * 64)
+        {
+            auto Files = std::make_shared<HTTP::StaticFiles const>(std::move(Root), MemoryLimit);
+
+            auto Handler = [Files](Connection::Context &Context, HTTP::Request &Request, std::string_view &&Path)
+            {
+                if (!Files->Serve(Context, Request, Path))
+                    Context.SendResponse(HTTP::Response::From(Request.Version, HTTP::Status::NotFound));
+            };
+
+            static_cast<T &>(*this).template GET<TRoute, true>(Handler);
+
+            return static_cast<T &>(*this).template HEAD<TRoute, true>(Handler);
+        }
+    };
+}
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <string>
+#include <charconv>
+#include <algorithm>
 #include <Machine.hpp>
+#include <Function.hpp>
 #include <Format/Stream.hpp>
 #include <Format/Hex.hpp>
-#include <Iterable/Queue.hpp>
+#include <Iterable/Buffer.hpp>
 #include <Network/Socket.hpp>
 #include <Network/HTTP/Request.hpp>
+#include <Network/HTTP/RequestView.hpp>
+#include <Network/HTTP/Scanner.hpp>
+#include <Network/HTTP/Codec.hpp>
 
 namespace Core::Network::HTTP
 {
@@ -16,15 +22,28 @@ namespace Core::Network::HTTP
         size_t HeaderLimit = 16 * 1024;
         size_t ContentLimit = 8 * 1024 * 1024;
         size_t RequestBufferSize = 1024;
-        Iterable::Queue<char> &Queue;
+        Iterable::Buffer<char> &Input;
         bool RawContent = false;
 
-        Parser(size_t headerLimit, size_t contentLimit, size_t SendBufferSize, Iterable::Queue<char> &queue, bool rawContent = false) : Machine(), HeaderLimit(headerLimit), ContentLimit(contentLimit), RequestBufferSize(SendBufferSize), Queue(queue), RawContent(rawContent)
+        // Only fills Result.View, whose fields point into Input, and leaves the owning fields empty
+
+        bool ZeroCopy = false;
+
+        // Stops once the head is complete and then hands the body to Sink piece by piece
+
+        bool Stream = false;
+
+        // Decodes content with a known content-encoding, null leaves it as is
+
+        Codec const *Decoder = nullptr;
+
+        Parser(size_t headerLimit, size_t contentLimit, size_t SendBufferSize, Iterable::Buffer<char> &input, bool rawContent = false, bool zeroCopy = false, bool stream = false, Codec const *decoder = nullptr) : Machine(), HeaderLimit(headerLimit), ContentLimit(contentLimit), RequestBufferSize(SendBufferSize), Input(input), RawContent(rawContent), ZeroCopy(zeroCopy), Stream(stream), Decoder(decoder)
         {
-            Queue = Iterable::Queue<char>(SendBufferSize);
+            Input = Iterable::Buffer<char>(SendBufferSize);
         }
 
-        Iterable::Queue<char> ContentBuffer;
+        Iterable::Buffer<char> ContentBuffer;
+        Iterable::Buffer<char> DecodedBuffer;
 
         size_t ContentLength = 0;
         size_t lenPos = 0;
@@ -32,46 +51,84 @@ namespace Core::Network::HTTP
         size_t bodyPos = 0;
         size_t bodyPosTmp = 0;
 
+        // Start of the line being parsed and count of head bytes already released
+
+        size_t LineStart = 0;
+        size_t HeadLength = 0;
+
         size_t ChunkLength = 0;
         size_t ChunkStart = 0;
         size_t ChunkStartTmp = 0;
 
         TMessage Result;
-        std::unordered_map<std::string, std::string>::iterator Iterator;
+        std::string_view Encoding;
+
+        // Address of the buffer the views of Result.View were taken from
+
+        char const *Base = nullptr;
 
         bool RequiresContinue100 = false;
 
+        // Streaming state, the sink returns false to pause until Paused is cleared
+
+        Core::Function<bool(std::string_view), 32> Sink;
+        size_t Remaining = 0;
+        size_t Piece = 0;
+        bool HeadDone = false;
+        bool Paused = false;
+
+        bool IsDecoded = false;
+
         void Reset()
         {
-            // Crop buffer's content
+            // Drop the request, what is left is usually the next pipelined
+            // request and is moved back to the start without reallocating
 
             Machine::Reset();
-            Queue.Free(bodyPos + ContentLength);
-            Queue.Resize(Queue.Length() + RequestBufferSize);
+            Input.Free(bodyPos + ContentLength);
+            Input.Compact();
+
+            // Memory taken by a large request is given back once the buffer is drained
+
+            if (Input.IsEmpty() && Input.Capacity() > HeaderLimit + RequestBufferSize)
+                Input = Iterable::Buffer<char>(RequestBufferSize);
 
             ContentLength = 0;
             lenPos = 0;
 
             bodyPos = 0;
             bodyPosTmp = 0;
+            LineStart = 0;
+            HeadLength = 0;
 
             // Clean request
 
+            if (!ZeroCopy)
             {
                 Result.Headers.clear();
+                Result.Content.clear();
             }
 
-            Iterator = Result.Headers.end();
+            Result.View.Clear();
+            ContentBuffer.Free();
+            DecodedBuffer.Free();
+            IsDecoded = false;
+
+            Encoding = {};
+            Base = nullptr;
             RequiresContinue100 = false;
+
+            Sink = nullptr;
+            Remaining = 0;
+            HeadDone = false;
+            Paused = false;
         }
 
         // @todo Make this asynchronous
 
         void Continue100()
         {
-            auto ExpectIterator = Result.Headers.find("expect");
-
-            if (ExpectIterator != Result.Headers.end() && ExpectIterator->second == "100-continue")
+            if (EqualsIgnoreCase(Result.View.Header("expect"), "100-continue"))
             {
                 RequiresContinue100 = true;
             }
@@ -79,88 +136,101 @@ namespace Core::Network::HTTP
 
         bool HasBody()
         {
-            return bool(bodyPos);
+            return Result.View.Has("content-length") || Encoding.data();
         }
 
         void operator()() override
         {
-            auto [Pointer, Size] = Queue.DataChunk();
+            char *Pointer = nullptr;
+            size_t Size = 0;
+            std::string_view Message;
 
-            std::string_view Message{Pointer, Size};
+            auto Load = [&]
+            {
+                std::tie(Pointer, Size) = Input.DataChunk();
+                Message = {Pointer, Size};
+                Base = Pointer;
+            };
 
-            CO_START;
+            // Buffer may have been reallocated while waiting for more data, only views of
+            // the zero copy mode point into it
 
-            // Take all the header
+            std::tie(Pointer, Size) = Input.DataChunk();
 
-            while (bodyPos == 0)
-            {
-                // @todo Optimize the no limitation case
+            if (ZeroCopy && Base && Base != Pointer)
+                Result.View.Rebase(Base, Pointer);
 
-                if (HeaderLimit && Message.length() > HeaderLimit)
-                {
-                    throw HTTP::Status::RequestEntityTooLarge;
-                }
+            Load();
 
-                bodyPosTmp = Message.find("\r\n\r\n", bodyPosTmp);
+            CO_START;
 
-                if (bodyPosTmp != std::string::npos)
-                {
-                    bodyPos = bodyPosTmp + 4;
+            // Take the header line by line, each read only scans the bytes it brought
 
-                    break;
-                }
+            while (true)
+            {
+                bodyPosTmp = Scanner::FindLine(Pointer, Size, bodyPosTmp);
 
-                bodyPosTmp = Message.length() - 3;
+                if (bodyPosTmp == std::string::npos)
+                {
+                    if (HeaderLimit && HeadLength + Size > HeaderLimit)
+                    {
+                        throw HTTP::Status::RequestEntityTooLarge;
+                    }
 
-                CO_YIELD();
-            }
+                    bodyPosTmp = Size;
 
-            // Parse first line and headers
+                    // Lines that were copied out are dropped so only the partial line stays buffered
 
-            {
-                size_t TempIndex = 0;
+                    if (!ZeroCopy && LineStart)
+                    {
+                        Release(LineStart);
+                    }
 
-                // @todo Remove try catch
+                    CO_YIELD();
 
-                try
-                {
-                    TempIndex = Result.ParseFirstLine(Message);
+                    continue;
                 }
-                catch (...)
+
+                if (ParseLine(Pointer + LineStart, bodyPosTmp - LineStart))
                 {
-                    throw HTTP::Status::BadRequest;
+                    LineStart = bodyPosTmp;
+                    break;
                 }
 
-                // Check for version
+                LineStart = bodyPosTmp;
+            }
 
-                if (Result.Version[0] != '1' || (Result.Version[2] != '0' && Result.Version[2] != '1'))
-                {
-                    throw HTTP::Status::HTTPVersionNotSupported;
-                }
+            bodyPos = LineStart;
+
+            // Body starts at the front of the buffer once the copied header is dropped
+
+            if (!ZeroCopy)
+            {
+                Release(bodyPos);
+                Load();
 
-                Result.ParseHeaders(Message, TempIndex, bodyPos);
+                bodyPos = 0;
             }
 
             // Check for content length
 
-            Iterator = Result.Headers.find("content-length");
-
-            if (Iterator != Result.Headers.end() && !Iterator->second.empty())
+            if (!Result.View.Header("content-length").empty())
             {
                 // Get the length of content
 
-                try
-                {
-                    ContentLength = std::stoull(Iterator->second);
-                }
-                catch (...)
                 {
-                    throw HTTP::Status::BadRequest;
+                    auto Length = Result.View.Header("content-length");
+                    auto [End, Error] = std::from_chars(Length.data(), Length.data() + Length.length(), ContentLength);
+
+                    if (Error != std::errc() || End != Length.data() + Length.length())
+                    {
+                        throw HTTP::Status::BadRequest;
+                    }
                 }
 
-                // Check if the length is in valid range
+                // Check if the length is in valid range, streamed bodies are never buffered whole
 
-                if (ContentLimit && ContentLength > ContentLimit)
+                if (!Stream && ContentLimit && ContentLength > ContentLimit)
                 {
                     throw HTTP::Status::RequestEntityTooLarge;
                 }
@@ -169,6 +239,36 @@ namespace Core::Network::HTTP
 
                 Continue100();
 
+                if (Stream)
+                {
+                    HeadDone = true;
+
+                    CO_YIELD();
+
+                    while (ContentLength)
+                    {
+                        if (Size == bodyPos)
+                        {
+                            CO_YIELD();
+                            continue;
+                        }
+
+                        Piece = std::min(Size - bodyPos, ContentLength);
+                        ContentLength -= Piece;
+
+                        if (!Emit(Pointer + bodyPos, Piece))
+                        {
+                            Paused = true;
+
+                            CO_YIELD();
+                        }
+
+                        Load();
+                    }
+
+                    CO_TERMINATE();
+                }
+
                 // Get the content
 
                 while (Message.length() - bodyPos < ContentLength)
@@ -178,18 +278,80 @@ namespace Core::Network::HTTP
 
                 // fill the content
 
-                Result.Content = Message.substr(bodyPos, ContentLength);
+                Result.View.Content = Message.substr(bodyPos, ContentLength);
             }
 
             // Check for content encoding
 
-            else if ((Iterator = Result.Headers.find("transfer-encoding")) == Result.Headers.end())
+            else if ((Encoding = Result.View.Header("transfer-encoding")).data() == nullptr)
+            {
+                Continue100();
+
+                if (Stream)
+                {
+                    HeadDone = true;
+
+                    CO_YIELD();
+                    CO_TERMINATE();
+                }
+            }
+            else if (EqualsIgnoreCase(Encoding, "chunked") && Stream)
             {
                 Continue100();
 
+                HeadDone = true;
+
+                CO_YIELD();
+
+                // Chunk framing is dropped from the buffer as it is read so only data reaches the sink
+
+                do
+                {
+                    while ((ChunkStartTmp = Message.find("\r\n", bodyPos)) == std::string::npos)
+                    {
+                        CO_YIELD();
+                    }
+
+                    ChunkLength = Format::Hex::To<size_t>(Message.substr(bodyPos, ChunkStartTmp - bodyPos));
+                    Remaining = ChunkLength;
+
+                    Input.Erase(bodyPos, ChunkStartTmp + 2 - bodyPos);
+                    Load();
+
+                    while (Remaining)
+                    {
+                        if (Size == bodyPos)
+                        {
+                            CO_YIELD();
+                            continue;
+                        }
+
+                        Piece = std::min(Size - bodyPos, Remaining);
+                        Remaining -= Piece;
+
+                        if (!Emit(Pointer + bodyPos, Piece))
+                        {
+                            Paused = true;
+
+                            CO_YIELD();
+                        }
+
+                        Load();
+                    }
+
+                    while (Size - bodyPos < 2)
+                    {
+                        CO_YIELD();
+                    }
+
+                    Input.Erase(bodyPos, 2);
+                    Load();
+
+                } while (ChunkLength);
+
                 CO_TERMINATE();
             }
-            else if (Iterator->second == "chunked")
+            else if (EqualsIgnoreCase(Encoding, "chunked"))
             {
                 Continue100();
 
@@ -233,18 +395,22 @@ namespace Core::Network::HTTP
 
                 } while (ChunkLength);
 
+                // Decoded content lives in ContentBuffer until Reset
+
                 if (RawContent)
                 {
-                    Result.Content = Message.substr(bodyPos, ChunkStart - bodyPos);
+                    Result.View.Content = Message.substr(bodyPos, ChunkStart - bodyPos);
                 }
                 else
                 {
-                    Result.Content = std::string{ContentBuffer.Content(), ContentBuffer.Length()};
-                    Result.Headers.erase(Iterator);
-                    ContentBuffer.Free();
+                    Result.View.Content = {ContentBuffer.Content(), ContentBuffer.Length()};
                 }
+
+                // Reset frees the request from the buffer by its length
+
+                ContentLength = ChunkStart - bodyPos;
             }
-            else if (Iterator->second == "gzip")
+            else if (EqualsIgnoreCase(Encoding, "gzip"))
             {
                 // Read the body chinks till the end
 
@@ -260,9 +426,137 @@ namespace Core::Network::HTTP
                 throw HTTP::Status::NotImplemented;
             }
 
+            // Compressed content is decoded into its own buffer, the content limit applies to the decoded size
+
+            if (Decoder && Decoder->Decode && !RawContent && EqualsIgnoreCase(Result.View.Header("content-encoding"), "gzip"))
+            {
+                try
+                {
+                    Decoder->Decode(Result.View.Content, DecodedBuffer, ContentLimit);
+                }
+                catch (std::length_error const &)
+                {
+                    throw HTTP::Status::RequestEntityTooLarge;
+                }
+                catch (...)
+                {
+                    throw HTTP::Status::BadRequest;
+                }
+
+                Result.View.Content = {DecodedBuffer.Content(), DecodedBuffer.Length()};
+                IsDecoded = true;
+            }
+
+            if (!ZeroCopy)
+            {
+                Result.Content = Result.View.Content;
+                Result.View.Content = Result.Content;
+
+                if (Encoding.data() && !RawContent)
+                    Result.Headers.erase("transfer-encoding");
+
+                if (IsDecoded)
+                {
+                    Result.Headers.erase("content-encoding");
+                    Result.Headers.erase("content-length");
+                }
+
+                if ((Encoding.data() && !RawContent) || IsDecoded)
+                    Result.LinkHeaders(Result.View);
+            }
+
             CO_TERMINATE();
 
             CO_END;
         }
+
+    private:
+        /**
+         * @brief Hands a piece of the body to the sink and drops it from the buffer
+         * @return False if the sink wants to pause
+         */
+        bool Emit(char const *Data, size_t Length)
+        {
+            bool Accepted = !Sink || Sink(std::string_view{Data, Length});
+
+            Input.Erase(bodyPos, Length);
+
+            return Accepted;
+        }
+
+        /**
+         * @brief Parses one complete line of the header
+         * @return True on the empty line that ends the header
+         */
+        bool ParseLine(char *Data, size_t Length)
+        {
+            bool IsEmpty = Length == 2 && Data[0] == '\r';
+
+            // Empty lines before the request line are ignored
+
+            if (!Result.View.Target.data())
+            {
+                if (IsEmpty)
+                    return false;
+
+                try
+                {
+                    Result.View.ParseRequestLine(Data, Length);
+                }
+                catch (...)
+                {
+                    throw HTTP::Status::BadRequest;
+                }
+
+                auto &Version = Result.View.Version;
+
+                if (Version.length() != 3 || Version[0] != '1' || (Version[2] != '0' && Version[2] != '1'))
+                {
+                    throw HTTP::Status::HTTPVersionNotSupported;
+                }
+
+                if (!ZeroCopy)
+                    Result.CopyLine(Result.View);
+
+                return false;
+            }
+
+            if (IsEmpty)
+            {
+                if (!ZeroCopy)
+                    Result.LinkHeaders(Result.View);
+
+                return true;
+            }
+
+            RequestView::Field Item;
+
+            try
+            {
+                Item = Result.View.ParseField(Data, Length);
+            }
+            catch (...)
+            {
+                throw HTTP::Status::BadRequest;
+            }
+
+            if (ZeroCopy)
+                Result.View.Headers.Add(Item);
+            else
+                Result.CopyField(Item);
+
+            return false;
+        }
+
+        // Drops parsed bytes from the front of the buffer, their room is reclaimed when the buffer needs to grow
+
+        void Release(size_t Count)
+        {
+            Input.Free(Count);
+
+            HeadLength += Count;
+            bodyPosTmp -= Count;
+            LineStart -= Count;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+namespace Core::Network::HTTP
+{
+    /**
+     * @brief Middleware stack composed at compile time
+     * Each layer is called as Layer(Args..., Next) and Next(Args...) runs the
+     * following layer, the last one hands over to the endpoint. The whole chain
+     * is one type, so nothing between the layers is type erased and the
+     * compiler can inline the request path end to end.
+     */
+    template <typename TEndpoint, typename... TLayers>
+    class Pipeline
+    {
+    public:
+        constexpr Pipeline(TEndpoint endpoint, TLayers... layers) : Endpoint(std::move(endpoint)), Layers(std::move(layers)...) {}
+
+        template <typename... TArgs>
+        inline void operator()(TArgs &...Args)
+        {
+            Step<0>(*this, Args...);
+        }
+
+        template <typename... TArgs>
+        inline void operator()(TArgs &...Args) const
+        {
+            Step<0>(*this, Args...);
+        }
+
+    private:
+        TEndpoint Endpoint;
+        std::tuple<TLayers...> Layers;
+
+        template <size_t Index, typename TSelf, typename... TArgs>
+        static inline void Step(TSelf &Self, TArgs &...Args)
+        {
+            if constexpr (Index == sizeof...(TLayers))
+            {
+                Self.Endpoint(Args...);
+            }
+            else
+            {
+                std::get<Index>(Self.Layers)(
+                    Args...,
+                    [&Self](auto &...Next)
+                    {
+                        Step<Index + 1>(Self, Next...);
+                    });
+            }
+        }
+    };
+
+    template <typename TEndpoint, typename... TLayers>
+    Pipeline(TEndpoint, TLayers...) -> Pipeline<TEndpoint, TLayers...>;
+}
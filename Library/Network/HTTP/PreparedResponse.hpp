@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <Network/HTTP/HTTP.hpp>
+#include <Network/HTTP/Response.hpp>
+
+namespace Core::Network::HTTP
+{
+    /**
+     * @brief Response serialized once and shared by every send
+     * Connections send the serialized head and body straight from the shared
+     * buffer, only the lines that depend on the connection or on the time of
+     * the send are written per response. Copies share the same buffer and
+     * queued sends keep it alive.
+     */
+    class PreparedResponse
+    {
+    public:
+        PreparedResponse() = default;
+
+        /**
+         * @brief Serializes a complete response, its content-length is fixed
+         * @param Dated Adds the loop's cached date line to every send, unless the response has its own
+         */
+        explicit PreparedResponse(HTTP::Response const &Response, bool Dated = true) : Version(Response.Version), Dated(Dated && !Response.Headers.contains("date"))
+        {
+            std::string Buffer = SerializeHead(Response);
+
+            if (Response.Headers.find("content-length") == Response.Headers.end())
+                Buffer.append("content-length: ").append(std::to_string(Response.Content.length())).append("\r\n");
+
+            HeadLength = Buffer.length();
+
+            Buffer.append("\r\n").append(Response.Content);
+
+            Data = std::make_shared<std::string const>(std::move(Buffer));
+        }
+
+        /**
+         * @brief Serializes only the head of a response, the content is given on each send
+         * and the content-length line is filled in then. Content of the response is ignored.
+         * @param Dated Adds the loop's cached date line to every send, unless the response has its own
+         */
+        static PreparedResponse Template(HTTP::Response const &Response, bool Dated = true)
+        {
+            PreparedResponse Result;
+
+            std::string Buffer = SerializeHead(Response);
+
+            Result.Version = Response.Version;
+            Result.Dated = Dated && !Response.Headers.contains("date");
+            Result.Sized = Response.Headers.find("content-length") == Response.Headers.end();
+            Result.IsTemplate = true;
+            Result.HeadLength = Buffer.length();
+            Result.Data = std::make_shared<std::string const>(std::move(Buffer));
+
+            return Result;
+        }
+
+        inline explicit operator bool() const
+        {
+            return bool(Data);
+        }
+
+        // Status line and fixed header lines
+
+        inline std::string_view Head() const
+        {
+            return {Data->data(), HeadLength};
+        }
+
+        // Blank line and content, empty for templates
+
+        inline std::string_view Tail() const
+        {
+            return std::string_view{*Data}.substr(HeadLength);
+        }
+
+        /**
+         * @brief Appends the lines filled in on each send
+         * @param Date Formatted date, see EventLoop::Date()
+         * @param Connection Connection line chosen by the connection or empty
+         */
+        template <typename TStream>
+        void SerializeSlots(TStream &Ser, std::string_view Date, std::string_view Connection, std::string_view Content = {}) const
+        {
+            if (Dated)
+                Ser << "date: " << Date << "\r\n";
+
+            Ser << Connection;
+
+            if (!IsTemplate)
+                return;
+
+            if (Sized)
+                Ser << "content-length: " << std::to_string(Content.length()) << "\r\n";
+
+            Ser << "\r\n"
+                << Content;
+        }
+
+        std::shared_ptr<std::string const> Data;
+        std::string Version;
+        size_t HeadLength = 0;
+        bool Dated = false;
+        bool Sized = false;
+        bool IsTemplate = false;
+
+    private:
+        static std::string SerializeHead(HTTP::Response const &Response)
+        {
+            std::string Buffer;
+
+            Buffer.append("HTTP/").append(Response.Version).append(" ").append(std::to_string(static_cast<unsigned short>(Response.Status))).append(" ").append(Response.Brief).append("\r\n");
+
+            for (auto const &[k, v] : Response.Headers)
+                Buffer.append(k).append(": ").append(v).append("\r\n");
+
+            Response.SetCookies.ForEach(
+                [&](auto const &Cookie)
+                {
+                    Buffer.append("set-cookie: ").append(Cookie).append("\r\n");
+                });
+
+            return Buffer;
+        }
+    };
+}
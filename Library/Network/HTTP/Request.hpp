@@ -10,6 +10,7 @@
 #include <Network/Socket.hpp>
 #include <Format/Stream.hpp>
 #include <Network/HTTP/Response.hpp>
+#include <Network/HTTP/RequestView.hpp>
 
 namespace Core
 {
@@ -36,6 +37,60 @@ namespace Core
                 Methods Method;
                 std::string Path;
 
+                // Filled by the parser in both modes, owning fields stay empty in zero copy mode
+
+                RequestView View;
+
+                Request() = default;
+
+                // A view pointing at the copied fields is pointed at the fields of the new request,
+                // a zero copy view keeps pointing into the parser's buffer
+
+                Request(Request const &Other) : Message(Other), Method(Other.Method), Path(Other.Path), View(Other.View)
+                {
+                    Relink(Other);
+                }
+
+                Request(Request &&Other) noexcept
+                {
+                    *this = std::move(Other);
+                }
+
+                Request &operator=(Request const &Other)
+                {
+                    if (this == &Other)
+                        return *this;
+
+                    Message::operator=(Other);
+                    Method = Other.Method;
+                    Path = Other.Path;
+                    View = Other.View;
+
+                    Relink(Other);
+
+                    return *this;
+                }
+
+                Request &operator=(Request &&Other) noexcept
+                {
+                    if (this == &Other)
+                        return *this;
+
+                    // Where the view points has to be read before the strings move
+
+                    bool OwnsLine = Other.OwnsLine();
+                    bool OwnsContent = Other.OwnsContent();
+
+                    Message::operator=(std::move(Other));
+                    Method = Other.Method;
+                    Path = std::move(Other.Path);
+                    View = std::move(Other.View);
+
+                    Relink(OwnsLine, OwnsContent);
+
+                    return *this;
+                }
+
                 friend Format::Stream &operator<<(Format::Stream &Ser, Request const &R)
                 {
                     Ser << MethodStrings[size_t(R.Method)] << ' ' << R.Path << " HTTP/" << R.Version << "\r\n";
@@ -210,6 +265,93 @@ namespace Core
                     return CursorTmp + 2;
                 }
 
+                /**
+                 * @brief Copies the request line of a view and points the view at the copies
+                 * so it stays valid once the parser releases the line from its buffer
+                 */
+                void CopyLine(RequestView &Source)
+                {
+                    Method = Source.Method;
+                    Path = Source.Target;
+                    Version = Source.Version;
+
+                    LinkLine(Source);
+                }
+
+                // Points the request line of a view at the copied line, the view keeps its split of path and query
+
+                void LinkLine(RequestView &Target) const
+                {
+                    auto QueryStart = Target.Path.length();
+                    bool HasQuery = Target.Query.data() != nullptr;
+
+                    Target.Target = Path;
+                    Target.Path = Target.Target.substr(0, QueryStart);
+                    Target.Query = HasQuery ? Target.Target.substr(QueryStart + 1) : std::string_view{};
+                    Target.Version = Version;
+                }
+
+                /**
+                 * @brief Copies a header field, names come lower cased from the parser
+                 * and cookie fields are merged with ';'
+                 */
+                void CopyField(RequestView::Field const &Item)
+                {
+                    if (Item.Name == "cookie")
+                    {
+                        auto [Iterator, IsNew] = Headers.try_emplace("cookie", Item.Value);
+
+                        if (!IsNew)
+                        {
+                            Iterator->second += ';';
+                            Iterator->second += Item.Value;
+                        }
+
+                        return;
+                    }
+
+                    Headers.insert_or_assign(std::string{Item.Name}, std::string{Item.Value});
+                }
+
+                // Points the header list of a view at the copied fields
+
+                void LinkHeaders(RequestView &Target) const
+                {
+                    Target.Headers.Free();
+
+                    for (auto const &[Key, Value] : Headers)
+                        Target.Headers.Add(Key, Value);
+                }
+
+                // Whether the view points at the copied line and fields rather than into a parser's buffer
+
+                inline bool OwnsLine() const
+                {
+                    return View.Target.data() && View.Target.data() == Path.data();
+                }
+
+                inline bool OwnsContent() const
+                {
+                    return View.Content.data() && View.Content.data() == Content.data();
+                }
+
+                void Relink(Request const &Other)
+                {
+                    Relink(Other.OwnsLine(), Other.OwnsContent());
+                }
+
+                void Relink(bool Line, bool Body)
+                {
+                    if (Line)
+                    {
+                        LinkLine(View);
+                        LinkHeaders(View);
+                    }
+
+                    if (Body)
+                        View.Content = Content;
+                }
+
                 static Request From(std::string_view Text, size_t BodyIndex = 0)
                 {
                     Request ret;
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <string_view>
+#include <stdexcept>
+#include <cstdint>
+
+#include <Iterable/List.hpp>
+#include <Network/HTTP/HTTP.hpp>
+#include <Network/HTTP/Scanner.hpp>
+
+namespace Core::Network::HTTP
+{
+    inline constexpr char ToLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    inline constexpr bool EqualsIgnoreCase(std::string_view Left, std::string_view Right)
+    {
+        if (Left.length() != Right.length())
+            return false;
+
+        for (size_t i = 0; i < Left.length(); i++)
+        {
+            if (ToLower(Left[i]) != ToLower(Right[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Request whose fields point into the connection's input buffer
+     * Nothing is copied or allocated once the header list has warmed up, every
+     * view stays valid until Parser::Reset() is called
+     */
+    struct RequestView
+    {
+        struct Field
+        {
+            std::string_view Name;
+            std::string_view Value;
+        };
+
+        Methods Method = Methods::Any;
+
+        // Target is the path with its query string
+
+        std::string_view Target;
+        std::string_view Path;
+        std::string_view Query;
+        std::string_view Version;
+        std::string_view Content;
+
+        // Fields in the order they came in, repeated fields are kept as separate entries
+
+        Iterable::List<Field> Headers = Iterable::List<Field>(16);
+
+        /**
+         * @brief Finds the first field with the given name, names are compared case insensitively
+         * @return Value of the field or an empty view with no data if there is no such field
+         */
+        std::string_view Header(std::string_view Name) const
+        {
+            for (size_t i = 0; i < Headers.Length(); i++)
+            {
+                if (EqualsIgnoreCase(Headers[i].Name, Name))
+                    return Headers[i].Value;
+            }
+
+            return {};
+        }
+
+        inline bool Has(std::string_view Name) const
+        {
+            return Header(Name).data() != nullptr;
+        }
+
+        /**
+         * @brief Validates and splits the request line
+         * @param Data Line including its CRLF
+         */
+        void ParseRequestLine(char *Data, size_t Length)
+        {
+            size_t Cursor = 0;
+            size_t Start = 0;
+
+            Cursor = Scanner::Scan(Data, Length, Scanner::Class::Token);
+
+            if (Cursor == 0 || Data[Cursor] != ' ')
+                throw std::invalid_argument("Invalid method");
+
+            Method = FromString({Data, Cursor});
+            Start = ++Cursor;
+
+            Cursor += Scanner::Scan(Data + Cursor, Length - Cursor, Scanner::Class::Target);
+
+            if (Cursor == Start || Data[Cursor] != ' ')
+                throw std::invalid_argument("Invalid path");
+
+            Target = {Data + Start, Cursor - Start};
+
+            auto QueryStart = Target.find('?');
+
+            Path = Target.substr(0, QueryStart);
+            Query = QueryStart == std::string_view::npos ? std::string_view{} : Target.substr(QueryStart + 1);
+
+            Start = ++Cursor;
+
+            Cursor += Scanner::Scan(Data + Cursor, Length - Cursor, Scanner::Class::Target);
+
+            if (Cursor - Start < 5 || std::string_view{Data + Start, 5} != "HTTP/" || Data[Cursor] != '\r' || Cursor + 2 != Length)
+                throw std::invalid_argument("Invalid version");
+
+            Version = {Data + Start + 5, Cursor - Start - 5};
+        }
+
+        /**
+         * @brief Validates and splits a header line, the name is lower cased in place
+         * so lookups and copies need no transform
+         * @param Data Line including its CRLF
+         */
+        Field ParseField(char *Data, size_t Length)
+        {
+            size_t Cursor = Scanner::Scan(Data, Length, Scanner::Class::Token);
+
+            if (Cursor == 0 || Data[Cursor] != ':')
+                throw std::invalid_argument("Invalid header field");
+
+            Scanner::Lower(Data, Cursor);
+
+            std::string_view Name{Data, Cursor};
+
+            // Skip the leading white space of the value
+
+            while (Data[++Cursor] == ' ' || Data[Cursor] == '\t')
+                ;
+
+            size_t Start = Cursor;
+
+            Cursor += Scanner::Scan(Data + Cursor, Length - Cursor, Scanner::Class::Text);
+
+            if (Data[Cursor] != '\r' || Cursor + 2 != Length)
+                throw std::invalid_argument("Invalid header value");
+
+            std::string_view Value{Data + Start, Cursor - Start};
+
+            while (!Value.empty() && (Value.back() == ' ' || Value.back() == '\t'))
+                Value.remove_suffix(1);
+
+            return {Name, Value};
+        }
+
+        /**
+         * @brief Moves every view to a new address of the same buffer
+         * The parser calls this when the input buffer was reallocated between two reads
+         */
+        void Rebase(char const *From, char const *To)
+        {
+            auto Move = [From, To](std::string_view &View)
+            {
+                if (View.data())
+                    View = {To + (reinterpret_cast<uintptr_t>(View.data()) - reinterpret_cast<uintptr_t>(From)), View.length()};
+            };
+
+            Move(Target);
+            Move(Path);
+            Move(Query);
+            Move(Version);
+            Move(Content);
+
+            Headers.ForEach(
+                [&](Field &Item)
+                {
+                    Move(Item.Name);
+                    Move(Item.Value);
+                });
+        }
+
+        void Clear()
+        {
+            Method = Methods::Any;
+            Target = {};
+            Path = {};
+            Query = {};
+            Version = {};
+            Content = {};
+            Headers.Free();
+        }
+    };
+}
@@ -1,8 +1,16 @@
 #pragma once
 
 #include <tuple>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <functional>
+#include <string_view>
 
+#include <Function.hpp>
 #include <Extra/ctre_extension.hpp>
 #include <Iterable/List.hpp>
 
@@ -74,14 +82,55 @@ struct Router
 {
 };
 
+/**
+ * @brief Radix tree of routes built at registration
+ * Literal parts of the patterns share their common prefixes and every "[]" is a
+ * parameter edge that takes one path segment, so a lookup only walks the nodes
+ * the path leads to. Patterns are taken literally apart from "[]".
+ * When several routes match, the one registered first wins as before.
+ */
 template <typename... TArgs>
 class Router<void(TArgs...)>
 {
 protected:
+    static constexpr size_t MaxCaptures = 16;
+    static constexpr size_t MethodCount = static_cast<size_t>(Network::HTTP::Methods::Any) + 1;
+    static constexpr size_t None = static_cast<size_t>(-1);
+
     using TDefault = std::function<void(TArgs...)>;
-    using TMatcher = std::function<bool(std::string_view, TArgs...)>;
+    using THandler = Core::Function<void(std::string_view const *, TArgs...), 32>;
+
+    // Routes ending at a node, indexed by method and holding registration indexes
+
+    using Slots = std::array<size_t, MethodCount>;
+
+    struct Node
+    {
+        std::string Label;
+        std::vector<std::unique_ptr<Node>> Children;
+        std::unique_ptr<Node> Parameter;
+        Slots Exact;
+        Slots Group;
+
+        // Lowest registration index in this subtree, lets lookups skip what cannot win
 
-    Iterable::List<std::tuple<Network::HTTP::Methods, TMatcher>> Routes;
+        size_t Lowest = None;
+
+        Node(std::string label = {}) : Label(std::move(label))
+        {
+            Exact.fill(None);
+            Group.fill(None);
+        }
+    };
+
+    struct Found
+    {
+        size_t Index = None;
+        std::string_view Captures[MaxCaptures];
+    };
+
+    Node Root;
+    Iterable::List<THandler> Handlers;
 
 public:
     TDefault Default;
@@ -96,15 +145,15 @@ public:
     template <typename... RTArgs>
     void Match(std::string_view Path, Network::HTTP::Methods Method, RTArgs &&...Args) const
     {
-        for (size_t i = 0; i < Routes.Length(); i++)
-        {
-            auto RouteMethod = std::get<0>(Routes[i]);
-            auto &Route = std::get<1>(Routes[i]);
+        Found Best;
+        std::string_view Captures[MaxCaptures];
 
-            if ((RouteMethod == Network::HTTP::Methods::Any || RouteMethod == Method) && Route(Path, std::forward<RTArgs>(Args)...))
-            {
-                return;
-            }
+        Search(Root, Path, static_cast<size_t>(Method), Captures, 0, Best);
+
+        if (Best.Index != None)
+        {
+            Handlers[Best.Index](Best.Captures, std::forward<RTArgs>(Args)...);
+            return;
         }
 
         Default(Args...);
@@ -113,13 +162,166 @@ public:
     template <ctll::fixed_string TSignature, bool Group = false, typename TCallback>
     void Add(Network::HTTP::Methods Method, TCallback &&Callback)
     {
-        using T = Route<TSignature, Group>;
+        constexpr size_t Count = FindCount<TSignature, "[]">();
+
+        static_assert(Count + Group <= MaxCaptures, "Too many parameters in route");
 
-        Routes.Add(
-            Method,
-            [CB = std::forward<TCallback>(Callback)](std::string_view Path, TArgs &&...Args)
+        Handlers.Add(
+            [CB = std::forward<TCallback>(Callback)](std::string_view const *Captures, TArgs &&...Args)
             {
-                return T::Apply(Path, CB, std::forward<TArgs>(Args)...);
+                [&]<size_t... S>(std::index_sequence<S...>)
+                {
+                    std::invoke(CB, std::forward<TArgs>(Args)..., std::string_view{Captures[S]}...);
+                }(std::make_index_sequence<Count + Group>{});
             });
+
+        size_t Index = Handlers.Length() - 1;
+        Node *Current = &Root;
+        std::string Literal;
+
+        Current->Lowest = std::min(Current->Lowest, Index);
+
+        for (size_t i = 0; i < TSignature.size(); i++)
+        {
+            if (TSignature[i] == '[' && i + 1 < TSignature.size() && TSignature[i + 1] == ']')
+            {
+                Current = Insert(*Current, Literal, Index);
+                Literal.clear();
+
+                if (!Current->Parameter)
+                    Current->Parameter = std::make_unique<Node>();
+
+                Current = Current->Parameter.get();
+                Current->Lowest = std::min(Current->Lowest, Index);
+                i++;
+
+                continue;
+            }
+
+            Literal += static_cast<char>(TSignature[i]);
+        }
+
+        Current = Insert(*Current, Literal, Index);
+
+        auto &Slot = (Group ? Current->Group : Current->Exact)[static_cast<size_t>(Method)];
+
+        if (Slot == None)
+            Slot = Index;
+    }
+
+protected:
+    /**
+     * @brief Walks down the literal edges that spell Text, splitting edges that only share a prefix
+     * @return Node at the end of Text
+     */
+    static Node *Insert(Node &Parent, std::string_view Text, size_t Index)
+    {
+        Node *Current = &Parent;
+
+        while (!Text.empty())
+        {
+            Node *Next = nullptr;
+
+            for (auto &Child : Current->Children)
+            {
+                if (Child->Label[0] == Text[0])
+                {
+                    Next = Child.get();
+                    break;
+                }
+            }
+
+            if (!Next)
+            {
+                Current->Children.push_back(std::make_unique<Node>(std::string{Text}));
+                Current = Current->Children.back().get();
+                Current->Lowest = Index;
+
+                return Current;
+            }
+
+            size_t Common = 0;
+
+            while (Common < Next->Label.length() && Common < Text.length() && Next->Label[Common] == Text[Common])
+                Common++;
+
+            if (Common < Next->Label.length())
+            {
+                // Split the edge, the old node keeps its subtree below the new one
+
+                auto Split = std::make_unique<Node>(Next->Label.substr(0, Common));
+
+                for (auto &Child : Current->Children)
+                {
+                    if (Child.get() == Next)
+                    {
+                        Next->Label.erase(0, Common);
+                        Split->Lowest = Next->Lowest;
+                        Split->Children.push_back(std::move(Child));
+                        Child = std::move(Split);
+                        Next = Child.get();
+                        break;
+                    }
+                }
+            }
+
+            Next->Lowest = std::min(Next->Lowest, Index);
+            Current = Next;
+            Text.remove_prefix(Common);
+        }
+
+        return Current;
+    }
+
+    static inline size_t Pick(Slots const &Slot, size_t Method)
+    {
+        return std::min(Slot[Method], Slot[MethodCount - 1]);
+    }
+
+    // Routes may end with a slash or a query, group routes take the rest of the path as one more capture
+
+    void Search(Node const &Current, std::string_view Rest, size_t Method, std::string_view *Captures, size_t Depth, Found &Best) const
+    {
+        if (Current.Lowest >= Best.Index)
+            return;
+
+        bool IsEnd = Rest.empty() || Rest[0] == '?';
+
+        if (size_t Index = Pick(Current.Exact, Method); Index < Best.Index && (IsEnd || Rest == "/"))
+            Take(Best, Index, Captures, Depth);
+
+        if (size_t Index = Pick(Current.Group, Method); Index < Best.Index && (IsEnd || Rest[0] == '/'))
+        {
+            Take(Best, Index, Captures, Depth);
+
+            Best.Captures[Depth] = IsEnd ? std::string_view{} : Rest.substr(1, Rest.find('?') - 1);
+        }
+
+        for (auto &Child : Current.Children)
+        {
+            if (Rest.starts_with(Child->Label))
+                Search(*Child, Rest.substr(Child->Label.length()), Method, Captures, Depth, Best);
+        }
+
+        if (!Current.Parameter)
+            return;
+
+        // Parameters take the longest run first like the greedy expression did
+
+        size_t End = std::min(Rest.find_first_of("/?"), Rest.length());
+
+        for (size_t Length = End; Length > 0; Length--)
+        {
+            Captures[Depth] = Rest.substr(0, Length);
+
+            Search(*Current.Parameter, Rest.substr(Length), Method, Captures, Depth + 1, Best);
+        }
+    }
+
+    static inline void Take(Found &Best, size_t Index, std::string_view const *Captures, size_t Depth)
+    {
+        Best.Index = Index;
+
+        std::copy(Captures, Captures + Depth, Best.Captures);
     }
 };
\ No newline at end of file
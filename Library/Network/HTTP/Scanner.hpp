@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CORE_SCANNER_X86
+#endif
+
+namespace Core::Network::HTTP::Scanner
+{
+    /**
+     * @brief Byte classes of the request head
+     * Every scan returns the length of the leading run of bytes in its class,
+     * so the byte it stops at is the delimiter the caller has to check
+     */
+    enum class Class : unsigned char
+    {
+        // Method and header names, RFC 9110 tchar
+
+        Token = 1,
+
+        // Request target, visible characters and obs-text
+
+        Target = 2,
+
+        // Header values, visible characters, spaces, tabs and obs-text
+
+        Text = 4
+    };
+
+    enum class Level
+    {
+        Scalar,
+        SSE42,
+        AVX2
+    };
+
+    inline constexpr std::array<unsigned char, 256> Table = []
+    {
+        std::array<unsigned char, 256> Result{};
+
+        for (size_t c = 0; c < 256; c++)
+        {
+            bool IsVisible = c > 0x20 && c != 0x7f;
+            bool IsToken = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || std::string_view("!#$%&'*+-.^_`|~").find(static_cast<char>(c)) != std::string_view::npos;
+
+            Result[c] = (IsToken ? static_cast<unsigned char>(Class::Token) : 0) |
+                        (IsVisible ? static_cast<unsigned char>(Class::Target) : 0) |
+                        (IsVisible || c == ' ' || c == '\t' ? static_cast<unsigned char>(Class::Text) : 0);
+        }
+
+        return Result;
+    }();
+
+    inline size_t ScanScalar(char const *Data, size_t Length, Class Kind)
+    {
+        size_t i = 0;
+
+        while (i < Length && (Table[static_cast<unsigned char>(Data[i])] & static_cast<unsigned char>(Kind)))
+            i++;
+
+        return i;
+    }
+
+#ifdef CORE_SCANNER_X86
+
+    inline Level Detect()
+    {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return Level::AVX2;
+
+        if (__builtin_cpu_supports("sse4.2"))
+            return Level::SSE42;
+
+        return Level::Scalar;
+    }
+
+    // Ranges of bytes that end a run, pairs of inclusive bounds for pcmpestri padded to
+    // a full register. Token's last range also covers '|' and '~', the scalar path continues past those
+
+    alignas(16) inline constexpr char TokenStops[16] = {'\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'};
+    alignas(16) inline constexpr char TargetStops[16] = {'\x00', ' ', '\x7f', '\x7f'};
+    alignas(16) inline constexpr char TextStops[16] = {'\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'};
+
+    __attribute__((target("sse4.2"))) inline size_t ScanSSE42(char const *Data, size_t Length, char const *Stops, int StopsLength)
+    {
+        __m128i Ranges = _mm_load_si128(reinterpret_cast<__m128i const *>(Stops));
+        size_t i = 0;
+
+        for (; i + 16 <= Length; i += 16)
+        {
+            __m128i Block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(Data + i));
+
+            int Index = _mm_cmpestri(Ranges, StopsLength, Block, 16, _SIDD_LEAST_SIGNIFICANT | _SIDD_CMP_RANGES | _SIDD_UBYTE_OPS);
+
+            if (Index != 16)
+                return i + Index;
+        }
+
+        return i;
+    }
+
+    // Runs end at control characters and DEL, targets also end at space and text allows tabs
+
+    template <bool IsText>
+    __attribute__((target("avx2"))) inline size_t ScanAVX2(char const *Data, size_t Length)
+    {
+        __m256i Bound = _mm256_set1_epi8(IsText ? 0x1f : 0x20);
+        __m256i Tab = _mm256_set1_epi8('\t');
+        __m256i Delete = _mm256_set1_epi8(0x7f);
+        size_t i = 0;
+
+        for (; i + 32 <= Length; i += 32)
+        {
+            __m256i Block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(Data + i));
+
+            __m256i Control = _mm256_cmpeq_epi8(_mm256_min_epu8(Block, Bound), Block);
+
+            if constexpr (IsText)
+                Control = _mm256_andnot_si256(_mm256_cmpeq_epi8(Block, Tab), Control);
+
+            Control = _mm256_or_si256(Control, _mm256_cmpeq_epi8(Block, Delete));
+
+            unsigned Mask = static_cast<unsigned>(_mm256_movemask_epi8(Control));
+
+            if (Mask)
+                return i + __builtin_ctz(Mask);
+        }
+
+        return i;
+    }
+
+    __attribute__((target("avx2"))) inline void LowerAVX2(char *Data, size_t Length)
+    {
+        __m256i Upper = _mm256_set1_epi8('A');
+        __m256i Range = _mm256_set1_epi8(25);
+        __m256i Flag = _mm256_set1_epi8(0x20);
+
+        for (; Length >= 32; Data += 32, Length -= 32)
+        {
+            __m256i Block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(Data));
+            __m256i Shifted = _mm256_sub_epi8(Block, Upper);
+            __m256i IsUpper = _mm256_cmpeq_epi8(_mm256_min_epu8(Shifted, Range), Shifted);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(Data), _mm256_or_si256(Block, _mm256_and_si256(IsUpper, Flag)));
+        }
+
+        for (size_t i = 0; i < Length; i++)
+        {
+            if (Data[i] >= 'A' && Data[i] <= 'Z')
+                Data[i] += 'a' - 'A';
+        }
+    }
+
+    inline Level const Support = Detect();
+
+#else
+
+    inline Level const Support = Level::Scalar;
+
+#endif
+
+    /**
+     * @brief Length of the leading run of Data that belongs to Kind
+     * The vector paths skip whole blocks and the scalar path finishes
+     * the tail, so all levels return the same result
+     */
+    inline size_t Scan(char const *Data, size_t Length, Class Kind)
+    {
+        size_t i = 0;
+
+#ifdef CORE_SCANNER_X86
+
+        if (Support == Level::AVX2 && Kind != Class::Token)
+        {
+            i = Kind == Class::Text ? ScanAVX2<true>(Data, Length) : ScanAVX2<false>(Data, Length);
+        }
+        else if (Support != Level::Scalar)
+        {
+            switch (Kind)
+            {
+            case Class::Token:
+                i = ScanSSE42(Data, Length, TokenStops, 16);
+                break;
+            case Class::Target:
+                i = ScanSSE42(Data, Length, TargetStops, 4);
+                break;
+            case Class::Text:
+                i = ScanSSE42(Data, Length, TextStops, 6);
+                break;
+            }
+        }
+
+#endif
+
+        return i + ScanScalar(Data + i, Length - i, Kind);
+    }
+
+    /**
+     * @brief Finds the end of the next line
+     * @return Index right after its line feed or npos
+     */
+    inline size_t FindLine(char const *Data, size_t Length, size_t From = 0)
+    {
+        if (From >= Length)
+            return static_cast<size_t>(-1);
+
+        auto Feed = static_cast<char const *>(std::memchr(Data + From, '\n', Length - From));
+
+        return Feed ? Feed - Data + 1 : static_cast<size_t>(-1);
+    }
+
+    inline void Lower(char *Data, size_t Length)
+    {
+#ifdef CORE_SCANNER_X86
+
+        if (Support == Level::AVX2)
+        {
+            LowerAVX2(Data, Length);
+            return;
+        }
+
+#endif
+
+        for (size_t i = 0; i < Length; i++)
+        {
+            if (Data[i] >= 'A' && Data[i] <= 'Z')
+                Data[i] += 'a' - 'A';
+        }
+    }
+}
@@ -51,6 +51,17 @@ namespace Core::Network::HTTP
 
         inline void GetInPool()
         {
+            // Listeners of the joined loop join their groups last, so their index is the loop's
+
+            size_t Last = Pool.LoopCount() - 1;
+
+            while (Joined.Length())
+            {
+                auto Item = Joined.Take();
+
+                Pool[Last].Assign(Bind(Item.Target), std::move(Item.Callback), std::move(Item.End), {0, 0});
+            }
+
             Pool.GetInPool(
                 [this]
                 {
@@ -68,21 +79,13 @@ namespace Core::Network::HTTP
         template <typename TCallback, typename TEndCallback>
         inline auto &ListenWith(Network::EndPoint const &endPoint, TCallback &&Callback, TEndCallback &&EndCallback)
         {
-            Network::Socket Router(static_cast<Network::Socket::SocketFamily>(endPoint.Address().Family()), Network::Socket::TCP);
-
-            // Set Reuse
-
-            Router.SetOptions(SOL_SOCKET, SO_REUSEADDR, static_cast<int>(1));
-            Router.SetOptions(SOL_SOCKET, SO_REUSEPORT, static_cast<int>(1));
-
-            // Bind socket
-
-            Router.Bind(endPoint);
-
-            Router.Listen();
+            if (PerLoopListeners)
+            {
+                return ListenEachWith(endPoint, std::forward<TCallback>(Callback), std::forward<TEndCallback>(EndCallback));
+            }
 
             Pool[Turn].Assign(
-                std::move(Router),
+                Bind(endPoint),
                 std::forward<TCallback>(Callback),
                 std::forward<TEndCallback>(EndCallback),
                 {0, 0});
@@ -92,6 +95,81 @@ namespace Core::Network::HTTP
             return *this;
         }
 
+        /**
+         * @brief Binds one listener per loop on the same end point so every
+         * loop accepts its own clients and the kernel balances between them,
+         * Callback is copied once per loop. The listener of the loop a thread
+         * joins with GetInPool is bound once it joins, until then its share of
+         * connections is spread over the others.
+         */
+        template <typename TCallback, typename TEndCallback>
+        inline auto &ListenEachWith(Network::EndPoint const &endPoint, TCallback &&Callback, TEndCallback &&EndCallback)
+        {
+            size_t Count = Pool.LoopCount();
+
+            for (size_t i = 0; i < Count; i++)
+            {
+                std::decay_t<TCallback> CallbackCopy(Callback);
+                std::decay_t<TEndCallback> EndCallbackCopy(EndCallback);
+
+                if (i == Count - 1)
+                {
+                    Joined.Insert({endPoint, std::move(CallbackCopy), std::move(EndCallbackCopy)});
+                    break;
+                }
+
+                auto Listener = Bind(endPoint);
+
+                // Attaching to any member of the group applies to the whole group,
+                // listener i belongs to loop i which is pinned to the i-th allowed cpu
+
+                if (ListenerAffinity && i == 0)
+                {
+                    auto CPUs = Async::ThreadPool::AllowedCPUs();
+
+                    Listener.AttachReusePortCPU({CPUs.Content(), CPUs.Length()}, Count);
+                }
+
+                Pool[i].Assign(
+                    std::move(Listener),
+                    std::move(CallbackCopy),
+                    std::move(EndCallbackCopy),
+                    {0, 0});
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Gives each loop its own SO_REUSEPORT listener
+         * Must be called before Listen
+         * @param CPUAffinity Pins loops to cpus and steers each connection
+         * to the loop running on the cpu that received it, a loop that could
+         * not be pinned is reported by AffinityError
+         */
+        inline auto &ReusePort(bool Enable, bool CPUAffinity = false)
+        {
+            PerLoopListeners = Enable;
+            ListenerAffinity = Enable && CPUAffinity;
+
+            Pool.Affinity(ListenerAffinity);
+
+            return *this;
+        }
+
+        inline bool ListensPerLoop() const
+        {
+            return PerLoopListeners;
+        }
+
+        /**
+         * @brief Error of pinning the loops to cpus once running, see ReusePort
+         */
+        inline std::error_code AffinityError() const
+        {
+            return Pool.AffinityError();
+        }
+
         inline bool TryIncrementConnectionCount()
         {
             if (ConnectionCount.fetch_add(1, std::memory_order_relaxed) > MaxConnectionCount)
@@ -123,6 +201,38 @@ namespace Core::Network::HTTP
 #endif
 
     protected:
+        Network::Socket Bind(Network::EndPoint const &endPoint)
+        {
+            // Non-blocking so accept callbacks can drain the backlog until EAGAIN
+
+            Network::Socket Listener(static_cast<Network::Socket::SocketFamily>(endPoint.Address().Family()), Network::Socket::TCP | Network::Socket::NonBlocking);
+
+            // Set Reuse
+
+            Listener.SetOptions(SOL_SOCKET, SO_REUSEADDR, static_cast<int>(1));
+            Listener.SetOptions(SOL_SOCKET, SO_REUSEPORT, static_cast<int>(1));
+
+            // Bind socket
+
+            Listener.Bind(endPoint);
+
+            Listener.Listen();
+
+            return Listener;
+        }
+
+        // Listener bound for the joined loop once GetInPool is called
+
+        struct JoinedListener
+        {
+            Network::EndPoint Target;
+            Async::EventLoop::CallbackType Callback;
+            Async::EventLoop::EndCallbackType End;
+        };
+
+        Iterable::List<JoinedListener> Joined;
+        bool PerLoopListeners = false;
+        bool ListenerAffinity = false;
         size_t MaxConnectionCount{1024};
         std::atomic<size_t> ConnectionCount{0};
         Async::ThreadPool Pool;
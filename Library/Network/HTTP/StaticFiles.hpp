@@ -0,0 +1,634 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <tuple>
+#include <charconv>
+#include <algorithm>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <File.hpp>
+#include <Watcher.hpp>
+#include <DateTime.hpp>
+#include <Network/HTTP/Codec.hpp>
+#include <Network/HTTP/Response.hpp>
+#include <Network/HTTP/Request.hpp>
+#include <Network/HTTP/PreparedResponse.hpp>
+#include <Network/HTTP/Connection.hpp>
+
+namespace Core::Network::HTTP
+{
+    /**
+     * @brief Serves the files under a directory
+     * Every loop keeps the files it served open along with their size, validators
+     * and type, so a cached hit costs no syscall besides sending it. Small files
+     * are kept in memory as prepared responses and larger ones are sent from the
+     * shared descriptor, with sendfile unless the connection is TLS without kernel
+     * offload. The .br and .gz siblings of a file are cached along with it and
+     * sent instead to clients that accept them when Modules::Compression looks
+     * up precompressed files. Entries are dropped as soon as inotify reports a
+     * change to their file, a sibling or their directory.
+     */
+    class StaticFiles
+    {
+    public:
+        /**
+         * @param MemoryLimit Files up to this size are kept in memory
+         * @param MaxEntries Cached files per loop, the cache starts over once it is full
+         */
+        StaticFiles(std::string root, size_t memoryLimit = 1024 * 64, size_t maxEntries = 4096)
+            : Root(std::move(root)), MemoryLimit(memoryLimit), MaxEntries(maxEntries), Id(NextId++)
+        {
+            while (Root.length() > 1 && Root.back() == '/')
+                Root.pop_back();
+        }
+
+        StaticFiles(StaticFiles const &Other) = delete;
+        StaticFiles &operator=(StaticFiles const &Other) = delete;
+
+        /**
+         * @brief Answers a GET or HEAD request with a file
+         * @param Path Path of the file under the root, a trailing slash serves its index.html
+         * @return False if there is no such file, nothing was sent then
+         */
+        bool Serve(Connection::Context const &Context, HTTP::Request const &Request, std::string_view Path) const
+        {
+            auto Item = Find(Context, Path);
+
+            if (!Item)
+                return false;
+
+            auto const &Chosen = Item->Pick(Context.SiblingEncodings());
+            auto const &View = Request.View;
+            bool IsHead = View.Method == HTTP::Methods::HEAD;
+
+            // If-Modified-Since only counts without If-None-Match, dates are compared as
+            // text since clients send back the last-modified value they were given
+
+            if (auto Tags = View.Header("if-none-match"); Tags.data() ? Matches(Tags, Chosen.ETag) : View.Header("if-modified-since") == Chosen.LastModified)
+            {
+                auto Response = Item->Response(Chosen, Request.Version, HTTP::Status::NotModified);
+
+                Response.Headers.insert_or_assign("content-length", std::to_string(Chosen.Size));
+
+                Context.SendResponse(Response);
+                return true;
+            }
+
+            size_t Start = 0;
+            size_t Length = Chosen.Size;
+            int Ranged = 0;
+
+            // A range is ignored when If-Range names another version of the file,
+            // on a sibling it counts bytes of the coded content
+
+            if (auto Range = View.Header("range"); Range.data() && !IsHead)
+            {
+                auto Condition = View.Header("if-range");
+
+                if (!Condition.data() || Condition == Chosen.ETag || Condition == Chosen.LastModified)
+                    Ranged = ParseRange(Range, Chosen.Size, Start, Length);
+            }
+
+            if (Ranged < 0)
+            {
+                auto Response = HTTP::Response::From(Request.Version, HTTP::Status::RequestedRangeNotSatisfiable);
+
+                Response.Headers.insert_or_assign("content-range", "bytes */" + std::to_string(Chosen.Size));
+                Response.Headers.insert_or_assign("content-length", "0");
+
+                Context.SendResponse(Response);
+                return true;
+            }
+
+            // The whole file from memory is a prepared response of HTTP/1.1
+
+            if (!Ranged && !IsHead && Chosen.Prepared && Request.Version == HTTP::HTTP11)
+            {
+                Context.SendResponse(Chosen.Prepared);
+                return true;
+            }
+
+            auto Response = Item->Response(Chosen, Request.Version, Ranged ? HTTP::Status::PartialContent : HTTP::Status::OK);
+
+            // Set length keeps the content from being coded again on its way out
+
+            Response.Headers.insert_or_assign("content-length", std::to_string(Length));
+
+            if (Ranged)
+                Response.Headers.insert_or_assign("content-range", "bytes " + std::to_string(Start) + '-' + std::to_string(Start + Length - 1) + '/' + std::to_string(Chosen.Size));
+
+            if (IsHead)
+            {
+                Context.SendResponse(Response);
+                return true;
+            }
+
+            if (Chosen.Prepared)
+            {
+                Response.Content = Chosen.Content().substr(Start, Length);
+
+                Context.SendResponse(Response);
+                return true;
+            }
+
+            Context.SendResponse(Response, Chosen.Source, Start, Length);
+
+            return true;
+        }
+
+    private:
+        // Precompressed siblings in the order they are preferred
+
+        static constexpr std::tuple<uint8_t, std::string_view, std::string_view> Siblings[] = {
+            {Codec::Brotli, ".br", "br"},
+            {Codec::GZip, ".gz", "gzip"},
+        };
+
+        /**
+         * @brief One coding of a file, its validators are its own so caches keep codings apart
+         */
+        struct Variant
+        {
+            std::shared_ptr<File const> Source;
+            size_t Size = 0;
+            std::string ETag;
+            std::string LastModified;
+            struct timespec Modified {};
+
+            // Empty for the file as it is
+
+            std::string_view Encoding;
+
+            // Whole response of a file small enough to be kept in memory
+
+            HTTP::PreparedResponse Prepared;
+
+            inline bool Exists() const
+            {
+                return Source || Prepared;
+            }
+
+            inline std::string_view Content() const
+            {
+                return Prepared.Tail().substr(2);
+            }
+        };
+
+        struct Entry
+        {
+            std::string_view Type;
+
+            // The file as it is first and then its siblings, a missing sibling does not exist
+
+            Variant Variants[1 + std::size(Siblings)];
+
+            // Preferred sibling the client accepts, or the file as it is
+
+            Variant const &Pick(uint8_t Encodings) const
+            {
+                for (size_t i = 0; Encodings && i < std::size(Siblings); i++)
+                {
+                    if ((Encodings & std::get<0>(Siblings[i])) && Variants[i + 1].Exists())
+                        return Variants[i + 1];
+                }
+
+                return Variants[0];
+            }
+
+            HTTP::Response Response(Variant const &Item, std::string_view Version, HTTP::Status Status) const
+            {
+                auto Result = HTTP::Response::From(
+                    Version,
+                    Status,
+                    {
+                        {"content-type", std::string{Type}},
+                        {"etag", Item.ETag},
+                        {"last-modified", Item.LastModified},
+                        {"accept-ranges", "bytes"},
+                        {"vary", "accept-encoding"},
+                    });
+
+                if (!Item.Encoding.empty())
+                    Result.Headers.insert_or_assign("content-encoding", std::string{Item.Encoding});
+
+                return Result;
+            }
+        };
+
+        // Keys are looked up with views so a hit does not allocate
+
+        struct KeyHash
+        {
+            using is_transparent = void;
+
+            inline size_t operator()(std::string_view Key) const
+            {
+                return std::hash<std::string_view>{}(Key);
+            }
+        };
+
+        using EntryMap = std::unordered_map<std::string, std::shared_ptr<Entry const>, KeyHash, std::equal_to<>>;
+
+        /**
+         * @brief Files one loop has open and the watches that keep them fresh
+         */
+        struct Cache
+        {
+            Watcher Notify;
+            EntryMap Entries;
+
+            // Directories by watch descriptor, as keys with their trailing slash
+
+            std::unordered_map<int, std::string> Directories;
+
+            void Invalidate(struct inotify_event const &Event)
+            {
+                // A lost event or a moved directory could leave any entry stale
+
+                if (Event.mask & (Watcher::Overflow | Watcher::Ignored | Watcher::DeletedSelf | Watcher::MovedSelf | Watcher::IsDirectory))
+                {
+                    Entries.clear();
+
+                    if (Event.mask & Watcher::Ignored)
+                        Directories.erase(Event.wd);
+
+                    return;
+                }
+
+                auto Directory = Directories.find(Event.wd);
+
+                if (Directory == Directories.end() || !Event.len)
+                    return;
+
+                std::string_view Name = Event.name;
+
+                Entries.erase(Directory->second + std::string{Name});
+
+                // A sibling belongs to the entry of its file, also when it was just created
+
+                for (auto [Coding, Extension, Encoding] : Siblings)
+                {
+                    if (Name.ends_with(Extension))
+                        Entries.erase(Directory->second + std::string{Name.substr(0, Name.length() - Extension.length())});
+                }
+            }
+        };
+
+        static constexpr uint32_t WatchEvents = Watcher::Attributes | Watcher::ClosedWrite | Watcher::Created | Watcher::Deleted | Watcher::DeletedSelf |
+                                                Watcher::Modified | Watcher::MovedSelf | Watcher::MovedFrom | Watcher::MovedTo | Watcher::OnlyDirectory;
+
+        static inline std::atomic_size_t NextId = 0;
+
+        std::string Root;
+        size_t MemoryLimit;
+        size_t MaxEntries;
+
+        // Caches of this thread are keyed by the id, an address could be reused
+
+        size_t Id;
+
+        /**
+         * @brief Cache of this instance on the loop running the request
+         * Its inotify instance is polled by the loop and only keeps a weak reference
+         */
+        Cache &LoopCache(Connection::Context const &Context) const
+        {
+            thread_local std::unordered_map<size_t, std::shared_ptr<Cache>> Caches;
+
+            auto &Result = Caches[Id];
+
+            if (Result)
+                return *Result;
+
+            Result = std::make_shared<Cache>();
+            Result->Notify = Watcher(Watcher::NonBlocking | Watcher::CloseOnExec);
+
+            // The loop owns a duplicate of the descriptor, the cache keeps adding watches to its own
+
+            int Duplicate = dup(Result->Notify.INode());
+
+            if (Duplicate < 0)
+                throw std::system_error(errno, std::generic_category());
+
+            Context.Loop.Assign(
+                Descriptor(Duplicate),
+                [Weak = std::weak_ptr<Cache>(Result)](Async::EventLoop::Context &Context, ePoll::Entry &)
+                {
+                    auto Shared = Weak.lock();
+
+                    if (!Shared)
+                    {
+                        Context.Remove();
+                        return;
+                    }
+
+                    Shared->Notify.Listen(
+                        [&](struct inotify_event const &Event)
+                        {
+                            Shared->Invalidate(Event);
+                        });
+                });
+
+            return *Result;
+        }
+
+        std::shared_ptr<Entry const> Find(Connection::Context const &Context, std::string_view Path) const
+        {
+            thread_local std::string Key;
+
+            if (!Resolve(Path, Key))
+                return nullptr;
+
+            auto &Files = LoopCache(Context);
+
+            if (auto Iterator = Files.Entries.find(std::string_view{Key}); Iterator != Files.Entries.end())
+                return Iterator->second;
+
+            auto Item = Load(Files, Key);
+
+            if (!Item)
+                return nullptr;
+
+            if (Files.Entries.size() >= MaxEntries)
+                Files.Entries.clear();
+
+            Files.Entries.emplace(Key, Item);
+
+            return Item;
+        }
+
+        /**
+         * @brief Opens a file and reads its metadata
+         * The directory is watched before the file is opened, so a change between
+         * the two is still reported
+         */
+        std::shared_ptr<Entry const> Load(Cache &Files, std::string const &Key) const
+        {
+            auto Slash = Key.rfind('/');
+            auto Directory = Slash == std::string::npos ? std::string{} : Key.substr(0, Slash + 1);
+
+            try
+            {
+                Files.Directories.insert_or_assign(Files.Notify.Add(Directory.empty() ? Root : Root + '/' + Directory, WatchEvents), Directory);
+            }
+            catch (std::system_error const &)
+            {
+                return nullptr;
+            }
+
+            auto Path = Root + '/' + Key;
+            auto Item = std::make_shared<Entry>();
+
+            Item->Type = HTTP::GetContentType(File::GetExtension(Key));
+
+            if (!LoadVariant(*Item, Item->Variants[0], Path, {}))
+                return nullptr;
+
+            for (size_t i = 0; i < std::size(Siblings); i++)
+            {
+                auto [Coding, Extension, Encoding] = Siblings[i];
+
+                auto &Sibling = Item->Variants[i + 1];
+
+                // A sibling compressed before the file was last edited is stale
+
+                if (LoadVariant(*Item, Sibling, Path + std::string{Extension}, Encoding) && IsOlder(Sibling.Modified, Item->Variants[0].Modified))
+                    Sibling = {};
+            }
+
+            return Item;
+        }
+
+        static bool IsOlder(struct timespec const &Left, struct timespec const &Right)
+        {
+            return Left.tv_sec != Right.tv_sec ? Left.tv_sec < Right.tv_sec : Left.tv_nsec < Right.tv_nsec;
+        }
+
+        /**
+         * @brief Opens one coding of a file and reads its metadata
+         * @return False if there is no such regular file
+         */
+        bool LoadVariant(Entry const &Owner, Variant &Item, std::string const &Path, std::string_view Encoding) const
+        {
+            int INode = open(Path.c_str(), File::ReadOnly | File::CloseOnExec);
+
+            if (INode < 0)
+                return false;
+
+            auto Source = std::make_shared<File const>(INode);
+
+            struct stat Info;
+
+            if (fstat(INode, &Info) < 0 || !S_ISREG(Info.st_mode))
+                return false;
+
+            Item.Size = Info.st_size;
+            Item.Modified = Info.st_mtim;
+            Item.Encoding = Encoding;
+
+            char Date[DateTime::IMFLength];
+
+            DateTime::FormatIMF(Info.st_mtim.tv_sec, Date);
+
+            Item.LastModified.assign(Date, sizeof(Date));
+
+            // Tag changes with the size or the modification time down to the nanosecond,
+            // siblings carry their coding as well
+
+            char Tag[64];
+            char *End = Tag;
+
+            *End++ = '"';
+            End = std::to_chars(End, Tag + sizeof(Tag), Info.st_size, 16).ptr;
+            *End++ = '-';
+            End = std::to_chars(End, Tag + sizeof(Tag), Info.st_mtim.tv_sec, 16).ptr;
+            *End++ = '.';
+            End = std::to_chars(End, Tag + sizeof(Tag), Info.st_mtim.tv_nsec, 16).ptr;
+
+            if (!Encoding.empty())
+            {
+                *End++ = '-';
+                End = std::copy(Encoding.begin(), Encoding.end(), End);
+            }
+
+            *End++ = '"';
+
+            Item.ETag.assign(Tag, End - Tag);
+
+            if (Item.Size > MemoryLimit)
+            {
+                Item.Source = std::move(Source);
+                return true;
+            }
+
+            auto Response = Owner.Response(Item, HTTP::HTTP11, HTTP::Status::OK);
+
+            Response.Content.resize(Item.Size);
+
+            size_t Done = 0;
+
+            while (Done < Item.Size)
+            {
+                ssize_t Result = pread(INode, Response.Content.data() + Done, Item.Size - Done, Done);
+
+                if (Result <= 0)
+                    return false;
+
+                Done += Result;
+            }
+
+            // Memory copy is all that is sent, the descriptor is not kept open
+
+            Item.Prepared = HTTP::PreparedResponse(Response);
+
+            return true;
+        }
+
+        /**
+         * @brief Turns a request path into a cache key under the root
+         * Percent escapes are decoded, paths with a dot dot segment or a null are refused
+         */
+        static bool Resolve(std::string_view Path, std::string &Key)
+        {
+            Key.clear();
+
+            while (!Path.empty() && Path.front() == '/')
+                Path.remove_prefix(1);
+
+            for (size_t i = 0; i < Path.length(); i++)
+            {
+                char c = Path[i];
+
+                if (c == '%')
+                {
+                    int Value = 0;
+
+                    if (i + 2 >= Path.length() || std::from_chars(Path.data() + i + 1, Path.data() + i + 3, Value, 16).ptr != Path.data() + i + 3)
+                        return false;
+
+                    c = static_cast<char>(Value);
+                    i += 2;
+                }
+
+                if (c == '\0')
+                    return false;
+
+                Key += c;
+            }
+
+            if (Key.empty() || Key.back() == '/')
+                Key += "index.html";
+
+            for (size_t Start = 0; Start <= Key.length();)
+            {
+                auto End = std::min(Key.find('/', Start), Key.length());
+
+                if (std::string_view{Key}.substr(Start, End - Start) == "..")
+                    return false;
+
+                Start = End + 1;
+            }
+
+            return true;
+        }
+
+        // Whether an If-None-Match list names the tag, weak tags match their strong form
+
+        static bool Matches(std::string_view List, std::string_view Tag)
+        {
+            while (!List.empty())
+            {
+                auto End = List.find(',');
+                auto Item = List.substr(0, End);
+
+                List = End == std::string_view::npos ? std::string_view{} : List.substr(End + 1);
+
+                while (!Item.empty() && (Item.front() == ' ' || Item.front() == '\t'))
+                    Item.remove_prefix(1);
+
+                while (!Item.empty() && (Item.back() == ' ' || Item.back() == '\t'))
+                    Item.remove_suffix(1);
+
+                if (Item.starts_with("W/"))
+                    Item.remove_prefix(2);
+
+                if (Item == "*" || Item == Tag)
+                    return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Reads a single byte range of a range header
+         * Several ranges would need a multipart body, the whole file is sent for them
+         * @return 1 for a range within the file, -1 if the range misses the file
+         * and 0 if the header is not understood and the whole file is sent
+         */
+        static int ParseRange(std::string_view Header, size_t Size, size_t &Start, size_t &Length)
+        {
+            if (!Header.starts_with("bytes=") || Header.find(',') != std::string_view::npos)
+                return 0;
+
+            Header.remove_prefix(6);
+
+            auto Dash = Header.find('-');
+
+            if (Dash == std::string_view::npos)
+                return 0;
+
+            auto First = Header.substr(0, Dash);
+            auto Last = Header.substr(Dash + 1);
+
+            size_t From = 0;
+            size_t To = 0;
+
+            // Suffix range, the last bytes of the file
+
+            if (First.empty())
+            {
+                if (!Number(Last, To))
+                    return 0;
+
+                if (To == 0 || Size == 0)
+                    return -1;
+
+                Start = Size - std::min(To, Size);
+                Length = Size - Start;
+
+                return 1;
+            }
+
+            if (!Number(First, From))
+                return 0;
+
+            if (From >= Size)
+                return -1;
+
+            To = Size - 1;
+
+            if (!Last.empty())
+            {
+                if (!Number(Last, To) || To < From)
+                    return 0;
+
+                To = std::min(To, Size - 1);
+            }
+
+            Start = From;
+            Length = To - From + 1;
+
+            return 1;
+        }
+
+        static inline bool Number(std::string_view Text, size_t &Value)
+        {
+            return !Text.empty() && std::from_chars(Text.data(), Text.data() + Text.length(), Value).ptr == Text.data() + Text.length();
+        }
+    };
+}
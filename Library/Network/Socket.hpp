@@ -4,8 +4,11 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <linux/filter.h>
 #include <system_error>
 #include <tuple>
+#include <span>
+#include <vector>
 
 #include <Descriptor.hpp>
 #include <Network/EndPoint.hpp>
@@ -38,6 +41,7 @@ namespace Core::Network
             UDP = SOCK_DGRAM,
             Raw = SOCK_RAW,
             NonBlocking = SOCK_NONBLOCK,
+            CloseExec = SOCK_CLOEXEC,
         };
 
         enum SocketMessage
@@ -49,6 +53,8 @@ namespace Core::Network
             Peek = MSG_PEEK,
             Truncate = MSG_TRUNC,
             WaitAll = MSG_WAITALL,
+            More = MSG_MORE,
+            NoSignal = MSG_NOSIGNAL,
         };
 
         enum ShutDownHow
@@ -154,6 +160,10 @@ namespace Core::Network
             }
         }
 
+        /**
+         * @brief Accepts a pending client
+         * @return Invalid socket if a non-blocking listener has nothing pending
+         */
         std::tuple<Socket, EndPoint> Accept(int Flags = 0) const
         {
             struct sockaddr_storage ClientAddress;
@@ -167,6 +177,11 @@ namespace Core::Network
 
             if (ClientDescriptor < 0)
             {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return {Socket(), EndPoint()};
+                }
+
                 throw std::system_error(errno, std::generic_category());
             }
 
@@ -184,8 +199,13 @@ namespace Core::Network
 
             // Error handling here
 
-            if (ClientDescriptor < 0 /* && errno != EAGAIN*/)
+            if (ClientDescriptor < 0)
             {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return Socket();
+                }
+
                 throw std::system_error(errno, std::generic_category());
             }
 
@@ -248,6 +268,47 @@ namespace Core::Network
             return Value;
         }
 
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+        /**
+         * @brief Steers new connections of this socket's SO_REUSEPORT group
+         * to the listener with the index of the receiving cpu in CPUs (modulo
+         * Count), or (receiving cpu % Count) for a cpu not listed. An index
+         * without a listener falls back to the hash of the connection.
+         * @param CPUs Cpus the listeners' loops are pinned to, in loop order
+         * @param Count Number of listeners in the group
+         */
+        void AttachReusePortCPU(std::span<int const> CPUs, size_t Count) const
+        {
+            std::vector<struct sock_filter> Code;
+
+            Code.reserve(CPUs.size() * 2 + 3);
+            Code.push_back({BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)});
+
+            for (size_t i = 0; i < CPUs.size(); i++)
+            {
+                Code.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(CPUs[i])});
+                Code.push_back({BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(i % Count)});
+            }
+
+            Code.push_back({BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(Count)});
+            Code.push_back({BPF_RET | BPF_A, 0, 0, 0});
+
+            if (Code.size() > BPF_MAXINSNS)
+            {
+                throw std::system_error(E2BIG, std::generic_category());
+            }
+
+            struct sock_fprog Program = {.len = static_cast<unsigned short>(Code.size()), .filter = Code.data()};
+
+            SetOptions(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &Program, sizeof(Program));
+        }
+#else
+        void AttachReusePortCPU(std::span<int const>, size_t) const
+        {
+            throw std::system_error(ENOTSUP, std::generic_category());
+        }
+#endif
+
         int Errors() const
         {
             int error = 0;
@@ -385,6 +446,34 @@ namespace Core::Network
             return Result;
         }
 
+        /**
+         * @brief Gathered send, writev with message flags
+         * @return Sent bytes or 0 if the socket would block
+         */
+        ssize_t Send(struct iovec *Vector, size_t Count, int Flags = 0) const
+        {
+            struct msghdr Message{};
+
+            Message.msg_iov = Vector;
+            Message.msg_iovlen = Count;
+
+            auto Result = sendmsg(_INode, &Message, Flags);
+
+            if (Result < 0)
+            {
+                if (errno == EAGAIN)
+                {
+                    return 0;
+                }
+                else
+                {
+                    throw std::system_error(errno, std::generic_category());
+                }
+            }
+
+            return Result;
+        }
+
         ssize_t Receive(char *Data, size_t Length, int Flags = 0) const
         {
             // @todo Fix return type or return result of recv
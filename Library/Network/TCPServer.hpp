@@ -2,6 +2,9 @@
 
 #include <string>
 #include <atomic>
+#include <exception>
+#include <tuple>
+#include <system_error>
 #include <netinet/tcp.h>
 
 #include <Duration.hpp>
@@ -23,7 +26,7 @@ namespace Core
             {
                 Settings.Timeout = Timeout;
 
-                Network::Socket Server(static_cast<Network::Socket::SocketFamily>(endPoint.Address().Family()), Network::Socket::TCP);
+                Network::Socket Server(static_cast<Network::Socket::SocketFamily>(endPoint.Address().Family()), Network::Socket::TCP | Network::Socket::NonBlocking);
 
                 // Set Reuse
 
@@ -38,39 +41,87 @@ namespace Core
 
                 Pool[0].Assign(
                     std::move(Server),
-                    [this, HandlerBuilder = std::forward<TCallback>(handlerBuilder), Counter = 0](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
+                    [this, HandlerBuilder = std::forward<TCallback>(handlerBuilder), Counter = 0, ListenerNoDelay = false](Async::EventLoop::Context &Context, ePoll::Entry &) mutable
                     {
                         Network::Socket &Server = static_cast<Network::Socket&>(Context.Self.File);
 
-                        auto [Client, Info] = Server.Accept();
+                        // Accepted sockets inherit TCP_NODELAY from the listener,
+                        // so only clients of this round need it set on their own
 
-                        if (ConnectionCount.fetch_add(1, std::memory_order_relaxed) > Settings.MaxConnectionCount)
+                        bool SetNoDelay = Settings.NoDelay && !ListenerNoDelay;
+
+                        if (SetNoDelay)
                         {
-                            ConnectionCount.fetch_sub(1, std::memory_order_relaxed);
-                            return;
+                            Server.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+                            ListenerNoDelay = true;
                         }
 
-                        // Set Non-blocking
+                        // Drain the backlog and hand clients over with one enqueue per loop
+
+                        Iterable::List<Async::EventLoop::AssignmentList> Batches(Pool.Length());
+
+                        for (size_t i = 0; i < Pool.Length(); i++)
+                            Batches.Add();
+
+                        std::exception_ptr Failure;
+
+                        while (true)
+                        {
+                            Network::Socket Client;
+                            Network::EndPoint Info;
+
+                            try
+                            {
+                                std::tie(Client, Info) = Server.Accept(Network::Socket::NonBlocking | Network::Socket::CloseExec);
+                            }
+                            catch (std::system_error const &Error)
+                            {
+                                // A client that left the backlog is skipped, running out of descriptors
+                                // or memory ends the round and the clients taken so far are still handed over
 
-                        Client.Blocking(false);
+                                int Code = Error.code().value();
 
-                        // Set NoDelay
+                                if (Code == ECONNABORTED || Code == EINTR)
+                                    continue;
 
-                        if (Settings.NoDelay)
-                            Client.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+                                if (Code != EMFILE && Code != ENFILE && Code != ENOBUFS && Code != ENOMEM)
+                                    Failure = std::current_exception();
 
-                        auto &Turn = Pool[Counter];
+                                break;
+                            }
 
-                        Turn.Assign(
-                            std::move(Client),
-                            HandlerBuilder(Info, Settings.Timeout),
-                            [this]
+                            if (!Client)
+                                break;
+
+                            if (ConnectionCount.fetch_add(1, std::memory_order_relaxed) > Settings.MaxConnectionCount)
                             {
                                 ConnectionCount.fetch_sub(1, std::memory_order_relaxed);
-                            },
-                            Settings.Timeout);
+                                continue;
+                            }
+
+                            if (SetNoDelay)
+                                Client.SetOptions(IPPROTO_TCP, TCP_NODELAY, static_cast<int>(1));
+
+                            Batches[Counter].Add(
+                                std::move(Client),
+                                HandlerBuilder(Info, Settings.Timeout),
+                                [this]
+                                {
+                                    ConnectionCount.fetch_sub(1, std::memory_order_relaxed);
+                                },
+                                Settings.Timeout);
+
+                            Counter = (Counter + 1) % Pool.Length();
+                        }
+
+                        for (size_t i = 0; i < Pool.Length(); i++)
+                        {
+                            if (Batches[i].Length())
+                                Pool[i].Assign(std::move(Batches[i]));
+                        }
 
-                        Counter = (Counter + 1) % Pool.Length();
+                        if (Failure)
+                            std::rethrow_exception(Failure);
                     },
                     nullptr,
                     {0, 0});
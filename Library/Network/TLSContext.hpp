@@ -2,7 +2,9 @@
 
 #include <string>
 #include <mutex>
+#include <memory>
 #include <Network/Socket.hpp>
+#include <Network/TLSSessions.hpp>
 #include <Format/Stream.hpp>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -18,6 +20,15 @@ namespace Core::Network
             SSL *ssl = nullptr;
             bool ShakeHand = false;
 
+            // Record layer offloaded to the kernel, known once the handshake is done
+
+            bool KernelSend = false;
+            bool KernelReceive = false;
+
+            // Handshake resumed an earlier session instead of a full key exchange
+
+            bool Resumed = false;
+
             SecureSocket() = default;
 
             SecureSocket(SSL_CTX *ctx) : ssl(SSL_new(ctx)) {}
@@ -42,10 +53,13 @@ namespace Core::Network
                 SSL_set_verify(ssl, mode, Callback);
             }
 
-            SecureSocket(SecureSocket &&Other) : ssl(Other.ssl), ShakeHand(Other.ShakeHand)
+            SecureSocket(SecureSocket &&Other) : ssl(Other.ssl), ShakeHand(Other.ShakeHand), KernelSend(Other.KernelSend), KernelReceive(Other.KernelReceive), Resumed(Other.Resumed)
             {
                 Other.ssl = nullptr;
                 Other.ShakeHand = false;
+                Other.KernelSend = false;
+                Other.KernelReceive = false;
+                Other.Resumed = false;
             }
 
             ~SecureSocket()
@@ -62,6 +76,26 @@ namespace Core::Network
             {
                 auto Res = SSL_do_handshake(ssl);
                 ShakeHand = (Res == 1);
+
+                if (ShakeHand)
+                {
+                    Resumed = SSL_session_reused(ssl);
+
+                    if (auto *Sessions = TLSSessions::Of(ssl))
+                        Sessions->Count(Resumed);
+                }
+
+                // OpenSSL turns kernel TLS on for each direction as the keys are set up,
+                // when the kernel has the tls module and supports the cipher
+
+#ifdef SSL_OP_ENABLE_KTLS
+                if (ShakeHand)
+                {
+                    KernelSend = BIO_get_ktls_send(SSL_get_wbio(ssl));
+                    KernelReceive = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+                }
+#endif
+
                 return Res;
             }
 
@@ -171,18 +205,61 @@ namespace Core::Network
                 return GotBytes;
             }
 
-            ssize_t SendFile(Descriptor const &descriptor, size_t Size, off_t Offset = 0) const
+            ssize_t Read(Iterable::Buffer<char> &Input)
             {
-                int Result = SSL_sendfile(ssl, descriptor.INode(), Offset, Size, 0);
+                ssize_t GotBytes = 0;
+
+                while (Input.IsFree())
+                {
+                    auto [Pointer, Size] = Input.EmptyChunk();
+
+                    int Result = SSL_read(ssl, Pointer, Size);
+
+                    if (Result <= 0)
+                    {
+                        int Error = SSL_get_error(ssl, Result);
+
+                        if (Error == SSL_ERROR_WANT_READ)
+                        {
+                            return GotBytes;
+                        }
 
-                // Error handling here
+                        return -1;
+                    }
+
+                    GotBytes += Result;
+                    Input.AdvanceTail(Result);
+
+                    if (static_cast<size_t>(Result) != Size)
+                        break;
+                }
+
+                return GotBytes;
+            }
+
+            /**
+             * @brief Sends part of a file, only works with kernel TLS sending
+             * @return Sent bytes or 0 if the socket would block
+             */
+            ssize_t SendFile(Descriptor const &descriptor, size_t Size, off_t Offset = 0) const
+            {
+#ifdef SSL_OP_ENABLE_KTLS
+                ssize_t Result = SSL_sendfile(ssl, descriptor.INode(), Offset, Size, 0);
 
                 if (Result < 0)
                 {
-                    throw std::runtime_error(std::to_string(GetError(Result)));
+                    int Error = GetError(Result);
+
+                    if (Error == SSL_ERROR_WANT_WRITE)
+                        return 0;
+
+                    throw std::runtime_error(std::to_string(Error));
                 }
 
                 return Result;
+#else
+                throw std::runtime_error("Sending files needs OpenSSL 3.0 with kernel TLS");
+#endif
             }
 
             friend bool operator<<(SecureSocket &descriptor, Format::Stream &Stream)
@@ -253,7 +330,11 @@ namespace Core::Network
 
         SSL_CTX *ctx = nullptr;
 
-        TLSContext(std::string_view Certification, std::string_view Key)
+        // Outlives ctx, whose callbacks refer to it
+
+        std::unique_ptr<TLSSessions> Sessions;
+
+        TLSContext(std::string_view Certification, std::string_view Key, TLSSessions::Options const &Resumption = {})
         {
             ctx = Create();
 
@@ -262,9 +343,13 @@ namespace Core::Network
             SetCertificate(Certification, SSL_FILETYPE_PEM);
             SetPrivateKey(Key, SSL_FILETYPE_PEM);
             CheckPrivateKey();
+            KernelTLS(true);
+
+            Sessions = std::make_unique<TLSSessions>(Resumption);
+            Sessions->Attach(ctx);
         }
 
-        TLSContext(TLSContext &&Other) : ctx(Other.ctx)
+        TLSContext(TLSContext &&Other) : ctx(Other.ctx), Sessions(std::move(Other.Sessions))
         {
             Other.ctx = nullptr;
         }
@@ -272,6 +357,7 @@ namespace Core::Network
         TLSContext &operator=(TLSContext &&Other)
         {
             ctx = Other.ctx;
+            Sessions = std::move(Other.Sessions);
             Other.ctx = nullptr;
             return *this;
         }
@@ -305,6 +391,34 @@ namespace Core::Network
             }
         }
 
+        /**
+         * @brief Lets OpenSSL hand the record layer of connections to the kernel
+         * Connections whose sending is offloaded send files with plain sendfile.
+         * Needs OpenSSL 3.0 built with kernel TLS and the tls kernel module,
+         * connections fall back to user space encryption otherwise.
+         * @return Whether this build of OpenSSL can offload at all
+         */
+        inline bool KernelTLS(bool Enable)
+        {
+#ifdef SSL_OP_ENABLE_KTLS
+            if (Enable)
+                SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+            else
+                SSL_CTX_clear_options(ctx, SSL_OP_ENABLE_KTLS);
+
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Handshake and resumption counters of connections made with this context
+
+        inline TLSSessions::Statistics Statistics() const
+        {
+            return Sessions ? Sessions->Report() : TLSSessions::Statistics{};
+        }
+
         inline SecureSocket NewSocket()
         {
             return SecureSocket(ctx);
@@ -346,6 +460,11 @@ namespace Core::Network
 
             SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
 
+            // A write retried after WANT_WRITE may come from a queue that grew and moved in between,
+            // as open streams append chunks while the socket is blocked
+
+            SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+
             return ctx;
         }
     };
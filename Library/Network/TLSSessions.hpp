@@ -0,0 +1,406 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <list>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <stdexcept>
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include <Duration.hpp>
+
+namespace Core::Network
+{
+    /**
+     * @brief Session resumption state of a TLS context, shared by every loop
+     * Stateless tickets are sealed with keys that rotate, a ticket sealed with
+     * the previous key is still accepted and replaced. Sessions of clients
+     * without tickets are kept in a cache split into stripes, each with its own
+     * lock, so handshakes on different loops rarely wait on each other.
+     */
+    class TLSSessions
+    {
+    public:
+        struct Options
+        {
+            // TLS 1.3 and 1.2 session tickets, without them TLS 1.3 resumes from the cache
+
+            bool Tickets = true;
+            Duration TicketRotation = {3600, 0};
+
+            // Sessions kept in the cache, 0 turns the cache off
+
+            size_t CacheSize = 1024 * 20;
+            Duration Lifetime = {7200, 0};
+        };
+
+        struct Statistics
+        {
+            size_t Handshakes = 0;
+            size_t Resumed = 0;
+            size_t CacheHits = 0;
+            size_t CacheMisses = 0;
+
+            inline double HitRate() const
+            {
+                return Handshakes ? static_cast<double>(Resumed) / Handshakes : 0;
+            }
+        };
+
+        TLSSessions(Options const &options) : Setting(options)
+        {
+            Rotate(std::time(nullptr));
+        }
+
+        ~TLSSessions()
+        {
+            OPENSSL_cleanse(&Current, sizeof(Current));
+            OPENSSL_cleanse(&Previous, sizeof(Previous));
+        }
+
+        TLSSessions(TLSSessions const &Other) = delete;
+        TLSSessions &operator=(TLSSessions const &Other) = delete;
+
+        /**
+         * @brief Sets up resumption on a context, the context refers to this instance until freed
+         */
+        void Attach(SSL_CTX *ctx)
+        {
+            SSL_CTX_set_app_data(ctx, this);
+
+            static constexpr unsigned char IdContext[] = "CoreKit";
+
+            SSL_CTX_set_session_id_context(ctx, IdContext, sizeof(IdContext) - 1);
+            SSL_CTX_set_timeout(ctx, Setting.Lifetime.Seconds);
+
+            if (Setting.Tickets)
+            {
+                SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+                SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, &OnTicket);
+#else
+                SSL_CTX_set_tlsext_ticket_key_cb(ctx, &OnTicket);
+#endif
+            }
+            else
+            {
+                SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+            }
+
+            if (!Setting.CacheSize)
+            {
+                SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+                return;
+            }
+
+            // The internal cache of OpenSSL has one lock for all loops, this one is used instead
+
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+            SSL_CTX_sess_set_new_cb(ctx, &OnNew);
+            SSL_CTX_sess_set_get_cb(ctx, &OnGet);
+            SSL_CTX_sess_set_remove_cb(ctx, &OnRemove);
+        }
+
+        // Instance attached to the context of a connection, if any
+
+        static inline TLSSessions *Of(SSL const *ssl)
+        {
+            return static_cast<TLSSessions *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        }
+
+        inline void Count(bool IsResumed)
+        {
+            Handshakes.fetch_add(1, std::memory_order_relaxed);
+
+            if (IsResumed)
+                Resumed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Statistics Report() const
+        {
+            return {
+                Handshakes.load(std::memory_order_relaxed),
+                Resumed.load(std::memory_order_relaxed),
+                Hits.load(std::memory_order_relaxed),
+                Misses.load(std::memory_order_relaxed),
+            };
+        }
+
+    private:
+        struct TicketKey
+        {
+            unsigned char Name[16];
+            unsigned char Cipher[32];
+            unsigned char MAC[32];
+            bool Valid = false;
+        };
+
+        // Position of a session in the order of its stripe, so a removed session leaves no id behind
+
+        struct Session
+        {
+            std::string Data;
+            time_t Expiry;
+            std::list<std::string>::iterator Position;
+        };
+
+        // Sessions of one stripe in the order they were added, the oldest goes first once it is full
+
+        struct Stripe
+        {
+            std::mutex Lock;
+            std::unordered_map<std::string, Session> Sessions;
+            std::list<std::string> Order;
+        };
+
+        static constexpr size_t StripeCount = 16;
+
+        Options Setting;
+
+        std::atomic_size_t Handshakes{0};
+        std::atomic_size_t Resumed{0};
+        std::atomic_size_t Hits{0};
+        std::atomic_size_t Misses{0};
+
+        // Current key seals new tickets, the previous one only opens them
+
+        std::shared_mutex KeyLock;
+        TicketKey Current;
+        TicketKey Previous;
+        std::atomic<time_t> RotateAt{0};
+
+        std::array<Stripe, StripeCount> Stripes;
+
+        void Rotate(time_t Now)
+        {
+            std::unique_lock Lock(KeyLock);
+
+            // Another loop may have rotated while this one waited
+
+            time_t Due = RotateAt.load(std::memory_order_relaxed);
+            time_t Period = std::max<time_t>(Setting.TicketRotation.Seconds, 1);
+
+            if (Now < Due)
+                return;
+
+            // Keys rotate on use, a key that would have been retired meanwhile opens no tickets
+
+            Previous = Current;
+            Previous.Valid = Current.Valid && Now < Due + Period;
+
+            if (RAND_bytes(Current.Name, sizeof(Current.Name)) != 1 ||
+                RAND_bytes(Current.Cipher, sizeof(Current.Cipher)) != 1 ||
+                RAND_bytes(Current.MAC, sizeof(Current.MAC)) != 1)
+                throw std::runtime_error("Failed to generate a ticket key");
+
+            Current.Valid = true;
+
+            RotateAt.store(Now + Period, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Sets up sealing or opening a ticket
+         * @return 1 to use the ticket, 2 to use it and issue a new one sealed with
+         * the current key, 0 for a full handshake and -1 on failure
+         */
+        template <typename TMAC>
+        int Ticket(unsigned char Name[16], unsigned char *IV, EVP_CIPHER_CTX *Cipher, TMAC *MAC, int Encrypt)
+        {
+            time_t Now = std::time(nullptr);
+
+            if (Now >= RotateAt.load(std::memory_order_relaxed))
+                Rotate(Now);
+
+            std::shared_lock Lock(KeyLock);
+
+            if (Encrypt)
+            {
+                std::memcpy(Name, Current.Name, sizeof(Current.Name));
+
+                if (RAND_bytes(IV, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1 ||
+                    EVP_EncryptInit_ex(Cipher, EVP_aes_256_cbc(), nullptr, Current.Cipher, IV) != 1 ||
+                    !InitMAC(MAC, Current.MAC))
+                    return -1;
+
+                return 1;
+            }
+
+            TicketKey const *Key = nullptr;
+
+            if (std::memcmp(Name, Current.Name, sizeof(Current.Name)) == 0)
+                Key = &Current;
+            else if (Previous.Valid && std::memcmp(Name, Previous.Name, sizeof(Previous.Name)) == 0)
+                Key = &Previous;
+
+            if (!Key)
+                return 0;
+
+            if (EVP_DecryptInit_ex(Cipher, EVP_aes_256_cbc(), nullptr, Key->Cipher, IV) != 1 || !InitMAC(MAC, Key->MAC))
+                return -1;
+
+            return Key == &Current ? 1 : 2;
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        static bool InitMAC(EVP_MAC_CTX *MAC, unsigned char const *Key)
+        {
+            OSSL_PARAM Parameters[] = {
+                OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char *>("SHA256"), 0),
+                OSSL_PARAM_construct_end(),
+            };
+
+            return EVP_MAC_init(MAC, Key, 32, Parameters) == 1;
+        }
+
+        static int OnTicket(SSL *ssl, unsigned char Name[16], unsigned char *IV, EVP_CIPHER_CTX *Cipher, EVP_MAC_CTX *MAC, int Encrypt)
+        {
+            return Of(ssl)->Ticket(Name, IV, Cipher, MAC, Encrypt);
+        }
+#else
+        static bool InitMAC(HMAC_CTX *MAC, unsigned char const *Key)
+        {
+            return HMAC_Init_ex(MAC, Key, 32, EVP_sha256(), nullptr) == 1;
+        }
+
+        static int OnTicket(SSL *ssl, unsigned char Name[16], unsigned char *IV, EVP_CIPHER_CTX *Cipher, HMAC_CTX *MAC, int Encrypt)
+        {
+            return Of(ssl)->Ticket(Name, IV, Cipher, MAC, Encrypt);
+        }
+#endif
+
+        inline Stripe &StripeOf(std::string_view Id)
+        {
+            return Stripes[std::hash<std::string_view>{}(Id) % StripeCount];
+        }
+
+        static inline std::string_view IdOf(SSL_SESSION const *Item)
+        {
+            unsigned int Length = 0;
+            auto const *Id = SSL_SESSION_get_id(Item, &Length);
+
+            return {reinterpret_cast<char const *>(Id), Length};
+        }
+
+        // Sessions are kept serialized, so the cache holds no references into OpenSSL
+
+        static int OnNew(SSL *ssl, SSL_SESSION *Item)
+        {
+            auto &Self = *Of(ssl);
+
+            // TLS 1.3 clients resume from their ticket, its session would never be looked up
+
+            if (Self.Setting.Tickets && SSL_version(ssl) == TLS1_3_VERSION)
+                return 0;
+
+            auto Id = IdOf(Item);
+
+            int Size = i2d_SSL_SESSION(Item, nullptr);
+
+            if (Size <= 0)
+                return 0;
+
+            std::string Data(Size, '\0');
+            auto *Cursor = reinterpret_cast<unsigned char *>(Data.data());
+
+            if (i2d_SSL_SESSION(Item, &Cursor) != Size)
+                return 0;
+
+            size_t Limit = std::max<size_t>(Self.Setting.CacheSize / StripeCount, 1);
+            auto &Part = Self.StripeOf(Id);
+
+            std::scoped_lock Lock(Part.Lock);
+
+            time_t Expiry = std::time(nullptr) + Self.Setting.Lifetime.Seconds;
+
+            // A session stored again keeps its place
+
+            if (auto Iterator = Part.Sessions.find(std::string{Id}); Iterator != Part.Sessions.end())
+            {
+                Iterator->second.Data = std::move(Data);
+                Iterator->second.Expiry = Expiry;
+
+                return 0;
+            }
+
+            while (Part.Sessions.size() >= Limit && !Part.Order.empty())
+            {
+                Part.Sessions.erase(Part.Order.front());
+                Part.Order.pop_front();
+            }
+
+            auto Position = Part.Order.emplace(Part.Order.end(), Id);
+
+            Part.Sessions.emplace(*Position, Session{std::move(Data), Expiry, Position});
+
+            return 0;
+        }
+
+        static SSL_SESSION *OnGet(SSL *ssl, unsigned char const *Id, int Length, int *Copy)
+        {
+            auto &Self = *Of(ssl);
+            std::string_view Key{reinterpret_cast<char const *>(Id), static_cast<size_t>(Length)};
+            auto &Part = Self.StripeOf(Key);
+
+            *Copy = 0;
+
+            std::string Data;
+
+            {
+                std::scoped_lock Lock(Part.Lock);
+
+                auto Iterator = Part.Sessions.find(std::string{Key});
+
+                if (Iterator != Part.Sessions.end() && Iterator->second.Expiry > std::time(nullptr))
+                    Data = Iterator->second.Data;
+            }
+
+            if (Data.empty())
+            {
+                Self.Misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            Self.Hits.fetch_add(1, std::memory_order_relaxed);
+
+            auto const *Cursor = reinterpret_cast<unsigned char const *>(Data.data());
+
+            return d2i_SSL_SESSION(nullptr, &Cursor, Data.length());
+        }
+
+        static void OnRemove(SSL_CTX *ctx, SSL_SESSION *Item)
+        {
+            auto *Self = static_cast<TLSSessions *>(SSL_CTX_get_app_data(ctx));
+
+            if (!Self)
+                return;
+
+            auto Id = IdOf(Item);
+            auto &Part = Self->StripeOf(Id);
+
+            std::scoped_lock Lock(Part.Lock);
+
+            auto Iterator = Part.Sessions.find(std::string{Id});
+
+            if (Iterator == Part.Sessions.end())
+                return;
+
+            Part.Order.erase(Iterator->second.Position);
+            Part.Sessions.erase(Iterator);
+        }
+    };
+}
@@ -2,13 +2,23 @@
 
 #include <array>
 #include <list>
+#include <time.h>
 
 #include <Duration.hpp>
 #include <Iterable/List.hpp>
+#include <Iterable/PoolAllocator.hpp>
 #include <Function.hpp>
 
 namespace Core
 {
+    /**
+     * @brief Hierarchical timing wheel over absolute monotonic deadlines
+     * Entries are kept in the lowest wheel that covers their distance to the deadline,
+     * a due bucket is detached in one splice and its entries are relinked straight into
+     * the wheel they belong to now.
+     * Entries that are due within the current tick are kept in a list sorted by their
+     * exact deadline, so owners that can wake up at Nearest() get sub-tick precision.
+     */
     template <size_t Steps, size_t Stages>
     class TimeWheel
     {
@@ -17,15 +27,15 @@ namespace Core
 
         struct Entry
         {
-            Function<void()> Callback;
-            std::array<size_t, Stages> Position;
+            UniqueFunction<void(), 32> Callback;
+            uint64_t Deadline;
             size_t Bucket;
             size_t Wheel;
         };
 
         struct Bucket
         {
-            using Container = std::list<Entry>;
+            using Container = std::list<Entry, Iterable::PoolAllocator<Entry>>;
             using Iterator = typename Container::iterator;
 
             Container Entries;
@@ -44,42 +54,6 @@ namespace Core
             {
                 Entries.erase(entry);
             }
-
-            void Execute()
-            {
-                if (Entries.size() <= 0)
-                    return;
-                    
-                for (auto &entry : Entries)
-                {
-                    if (entry.Callback)
-                        entry.Callback();
-                }
-
-                Entries.clear();
-            }
-
-            void Cascade(Wheel &Destination, size_t Stage)
-            {
-                // @todo Maybe user pointer to entry to make move faster?
-
-                while (!Entries.empty())
-                {
-                    auto Iterator = Entries.begin();
-
-                    // @todo Test this
-
-                    Iterator->Wheel = Stage;
-
-                    size_t &Index = Iterator->Position[Stage];
-
-                    auto &DestinationBucket = Destination.Buckets[Index].Entries;
-
-                    DestinationBucket.splice(DestinationBucket.end(), Entries, Iterator);
-                }
-
-                // bucket.clear();
-            }
         };
 
         struct Wheel
@@ -90,16 +64,14 @@ namespace Core
 
         TimeWheel() = default;
         TimeWheel(TimeWheel const &Other) = delete;
-        TimeWheel(TimeWheel &&Other) noexcept : Wheels(std::move(Other.Wheels)), Indices(std::move(Other.Indices)), IntervalMS(Other.IntervalMS) {}
+        TimeWheel(TimeWheel &&Other) noexcept : Wheels(std::move(Other.Wheels)), Near(std::move(Other.Near)), Firing(std::move(Other.Firing)), IntervalNS(Other.IntervalNS), Origin(Other.Origin), Ticks(Other.Ticks) {}
 
-        TimeWheel(Duration const &Interval) : IntervalMS(Interval.AsMilliseconds())
+        TimeWheel(Duration const &Interval) : IntervalNS(Interval.AsNanoseconds()), Origin(Clock())
         {
             size_t TempInterval = 1;
 
             for (size_t i = 0; i < Wheels.size(); i++)
             {
-                Indices[i] = 0;
-
                 Wheels[i].Interval = TempInterval;
                 TempInterval *= Steps;
             }
@@ -110,20 +82,23 @@ namespace Core
         TimeWheel &operator=(TimeWheel &&Other) noexcept
         {
             Wheels = std::move(Other.Wheels);
-            Indices = std::move(Other.Indices);
-            IntervalMS = std::move(Other.IntervalMS);
+            Near = std::move(Other.Near);
+            Firing = std::move(Other.Firing);
+            IntervalNS = Other.IntervalNS;
+            Origin = Other.Origin;
+            Ticks = Other.Ticks;
 
             return *this;
         }
 
         inline void Interval(Duration const &Interval)
         {
-            IntervalMS = Interval.AsMilliseconds();
+            IntervalNS = Interval.AsNanoseconds();
         }
 
         inline Duration Interval() const
         {
-            return Duration::FromMilliseconds(IntervalMS);
+            return Duration(static_cast<time_t>(IntervalNS / 1000000000), static_cast<time_t>(IntervalNS % 1000000000));
         }
 
         static constexpr size_t MaxSteps()
@@ -142,37 +117,106 @@ namespace Core
 
         Duration MaxDuration()
         {
-            return Duration::FromMilliseconds(MaxSteps() * IntervalMS);
+            return Duration::FromMilliseconds(MaxSteps() * (IntervalNS / 1000000));
         }
 
-        inline void Tick()
+        /**
+         * @brief Aligns the current tick to now, meant to be called when the ticking timer starts
+         */
+        inline void Start()
         {
-            Increment();
-
-            Current().Execute();
+            Origin = Clock() - Ticks * IntervalNS;
         }
 
-        template<typename TCallback>
-        typename Bucket::Iterator Add(size_t _Steps, TCallback&& Callback)
+        /**
+         * @brief Advances the wheel and fires everything that is due
+         * @param Count Number of elapsed ticks, an owner that stalled passes
+         * every expiration it missed so none of them is lost
+         */
+        void Tick(size_t Count = 1)
         {
-            Entry entry{std::forward<TCallback>(Callback), Offset(_Steps), 0, 0};
+            while (Count--)
+            {
+                Ticks++;
 
-            size_t Level = 0;
+                // Higher wheels first so their entries can land in the bucket due now
 
-            for (Level = Wheels.size() - 1; Level > 0 && entry.Position[Level] == 0; --Level)
-            {
+                for (size_t Level = Stages - 1; Level > 0; --Level)
+                {
+                    if (Ticks % Wheels[Level].Interval == 0)
+                        Relink(At(Level, (Ticks / Wheels[Level].Interval) % Steps));
+                }
+
+                Relink(At(0, Ticks % Steps));
             }
 
-            entry.Wheel = Level;
-            entry.Bucket = (entry.Position[Level] + Indices[Level]) % Wheels[Level].Buckets.size();
+            Advance();
+        }
+
+        /**
+         * @brief Fires the entries of the current tick whose exact deadline has passed
+         */
+        void Advance()
+        {
+            uint64_t Now = Clock();
+
+            auto Due = Near.begin();
+
+            while (Due != Near.end() && Due->Deadline <= Now)
+                ++Due;
+
+            if (Due == Near.begin())
+                return;
+
+            Fire(Near.begin(), Due);
+        }
+
+        /**
+         * @brief Exact deadline of the earliest entry due in the current tick
+         * @return Monotonic time in nanoseconds or 0 if there is none
+         */
+        inline uint64_t Nearest() const
+        {
+            return Near.empty() ? 0 : Near.front().Deadline;
+        }
+
+        /**
+         * @brief Count of ticks since the wheel was created
+         */
+        inline size_t Now() const
+        {
+            return Ticks;
+        }
 
-            return At(entry.Wheel, entry.Bucket).Add(std::move(entry));
+        inline size_t StepsOf(Duration const &Interval) const
+        {
+            return Interval.AsNanoseconds() / IntervalNS;
+        }
+
+        template<typename TCallback>
+        typename Bucket::Iterator Add(size_t _Steps, TCallback&& Callback)
+        {
+            return Insert(Clock() + _Steps * IntervalNS, std::forward<TCallback>(Callback));
         }
 
         template<typename TCallback>
         typename Bucket::Iterator Add(Duration const &Interval, TCallback&& Callback)
         {
-            return Add(Interval.AsMilliseconds() / IntervalMS, std::forward<TCallback>(Callback));
+            return Insert(Clock() + Interval.AsNanoseconds(), std::forward<TCallback>(Callback));
+        }
+
+        /**
+         * @brief Moves an entry to its new bucket in place
+         * The node is relinked so neither the callback nor the iterator changes
+         */
+        typename Bucket::Iterator Reschedule(typename Bucket::Iterator Iterator, size_t _Steps)
+        {
+            return Move(Iterator, Clock() + _Steps * IntervalNS);
+        }
+
+        typename Bucket::Iterator Reschedule(typename Bucket::Iterator Iterator, Duration const &Interval)
+        {
+            return Move(Iterator, Clock() + Interval.AsNanoseconds());
         }
 
         inline void Remove(typename Bucket::Iterator Iterator)
@@ -180,7 +224,7 @@ namespace Core
             if (Iterator == end())
                 return;
 
-            At(Iterator->Wheel, Iterator->Bucket).Remove(Iterator);
+            Owner(*Iterator).erase(Iterator);
         }
 
         inline Bucket &At(size_t _Wheel, size_t _Bucket)
@@ -190,7 +234,7 @@ namespace Core
 
         inline Bucket &Current(size_t Stage = 0)
         {
-            return At(Stage, Indices[Stage]);
+            return At(Stage, (Ticks / Wheels[Stage].Interval) % Steps);
         }
 
         inline auto end()
@@ -198,49 +242,162 @@ namespace Core
             return At(0, 0).Entries.end();
         }
 
+        static uint64_t Clock()
+        {
+            timespec Time;
+
+            clock_gettime(CLOCK_MONOTONIC, &Time);
+
+            return static_cast<uint64_t>(Time.tv_sec) * 1000000000 + Time.tv_nsec;
+        }
+
     private:
-        std::array<size_t, Stages> Offset(size_t _Steps)
+        // Wheel markers of entries that are not in a bucket
+
+        static constexpr size_t InNear = Stages;
+        static constexpr size_t InFiring = Stages + 1;
+
+        template <typename TCallback>
+        typename Bucket::Iterator Insert(uint64_t Deadline, TCallback &&Callback)
         {
-            std::array<size_t, Stages> Result;
+            Entry entry{std::forward<TCallback>(Callback), Deadline, 0, 0};
 
-            size_t Level = Wheels.size() - 1;
+            auto &Destination = Place(entry);
 
-            for (; _Steps && Level < Wheels.size(); --Level)
-            {
-                auto &_Interval = Wheels[Level].Interval;
+            auto Iterator = Destination.insert(Destination.end(), std::move(entry));
 
-                Result[Level] = _Steps / _Interval;
-                _Steps %= _Interval;
-            }
+            if (Iterator->Wheel == InNear)
+                Sort(Iterator);
+
+            return Iterator;
+        }
+
+        typename Bucket::Iterator Move(typename Bucket::Iterator Iterator, uint64_t Deadline)
+        {
+            if (Iterator == end())
+                return Iterator;
 
-            for (; Level < Wheels.size(); --Level)
+            auto &Source = Owner(*Iterator);
+
+            Iterator->Deadline = Deadline;
+
+            auto &Destination = Place(*Iterator);
+
+            Destination.splice(Destination.end(), Source, Iterator);
+
+            if (Iterator->Wheel == InNear)
+                Sort(Iterator);
+
+            return Iterator;
+        }
+
+        /**
+         * @brief Picks the list that covers the entry's deadline
+         * The lowest wheel whose span reaches the deadline is used, deadlines
+         * inside the current tick go to the sorted near list
+         */
+        typename Bucket::Container &Place(Entry &entry)
+        {
+            uint64_t Tick = entry.Deadline > Origin ? (entry.Deadline - Origin) / IntervalNS : 0;
+
+            if (Tick <= Ticks)
             {
-                Result[Level] = 0;
+                entry.Wheel = InNear;
+                return Near;
             }
 
-            return Result;
+            size_t Distance = Tick - Ticks;
+            size_t Level = 0;
+
+            while (Level < Stages - 1 && Distance >= Wheels[Level + 1].Interval)
+                Level++;
+
+            // Too far for the top wheel, it waits in the furthest bucket and is placed again from there
+
+            if (Distance >= MaxSteps())
+                Tick = Ticks + MaxSteps() - 1;
+
+            entry.Wheel = Level;
+            entry.Bucket = (Tick / Wheels[Level].Interval) % Steps;
+
+            return At(entry.Wheel, entry.Bucket).Entries;
+        }
+
+        // Keeps the near list ordered by deadline, new entries are usually the latest
+
+        void Sort(typename Bucket::Iterator Iterator)
+        {
+            auto Position = Iterator;
+
+            while (Position != Near.begin() && std::prev(Position)->Deadline > Iterator->Deadline)
+                --Position;
+
+            if (Position != Iterator)
+                Near.splice(Position, Near, Iterator);
         }
 
-        void Increment(size_t Level = 0)
+        void Relink(Bucket &Due)
         {
-            size_t &_Index = Indices[Level];
-            Wheel &_Wheel = Wheels[Level];
+            if (Due.Entries.empty())
+                return;
+
+            typename Bucket::Container Pending;
+
+            Pending.splice(Pending.end(), Due.Entries);
 
-            if (++_Index >= _Wheel.Buckets.size())
+            while (!Pending.empty())
             {
-                _Index = 0;
+                auto Iterator = Pending.begin();
 
-                if (Level >= (Wheels.size() - 1))
-                    return;
+                auto &Destination = Place(*Iterator);
 
-                Increment(++Level);
+                Destination.splice(Destination.end(), Pending, Iterator);
 
-                Current(Level).Cascade(_Wheel, Level - 1);
+                if (Iterator->Wheel == InNear)
+                    Sort(Iterator);
             }
         }
 
+        // Entries being fired are parked in their own list so callbacks
+        // can remove or reschedule any of them safely
+
+        void Fire(typename Bucket::Iterator First, typename Bucket::Iterator Last)
+        {
+            Firing.splice(Firing.end(), Near, First, Last);
+
+            for (auto &entry : Firing)
+                entry.Wheel = InFiring;
+
+            while (!Firing.empty())
+            {
+                auto Iterator = Firing.begin();
+
+                if (Iterator->Callback)
+                    Iterator->Callback();
+
+                // Still parked means it was neither removed nor rescheduled
+
+                if (!Firing.empty() && Firing.begin() == Iterator)
+                    Firing.erase(Iterator);
+            }
+        }
+
+        inline typename Bucket::Container &Owner(Entry const &entry)
+        {
+            if (entry.Wheel == InNear)
+                return Near;
+
+            if (entry.Wheel == InFiring)
+                return Firing;
+
+            return At(entry.Wheel, entry.Bucket).Entries;
+        }
+
         std::array<Wheel, Stages> Wheels;
-        std::array<size_t, Stages> Indices;
-        size_t IntervalMS;
+        typename Bucket::Container Near;
+        typename Bucket::Container Firing;
+        uint64_t IntervalNS;
+        uint64_t Origin;
+        size_t Ticks = 0;
     };
-}
\ No newline at end of file
+}
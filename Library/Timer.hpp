@@ -78,6 +78,21 @@ namespace Core
             }
         }
 
+        /**
+         * @brief One-shot expiry at an absolute time of the timer's clock
+         */
+        void SetAt(Duration Time)
+        {
+            struct itimerspec _Duration = {{0, 0}, {0, 0}};
+
+            Time.Fill(_Duration.it_value);
+
+            if (timerfd_settime(_INode, TFD_TIMER_ABSTIME, &_Duration, NULL) < 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+        }
+
         void Stop()
         {
             struct itimerspec _Duration = {{0, 0}, {0, 0}};
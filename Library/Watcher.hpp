@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <system_error>
+
+#include <Descriptor.hpp>
+
+namespace Core
+{
+    /**
+     * @brief inotify instance, reports changes to watched files and directories
+     */
+    class Watcher : public Descriptor
+    {
+    public:
+        enum WatcherFlags
+        {
+            CloseOnExec = IN_CLOEXEC,
+            NonBlocking = IN_NONBLOCK,
+        };
+
+        enum WatchEvents
+        {
+            Accessed = IN_ACCESS,
+            Attributes = IN_ATTRIB,
+            ClosedWrite = IN_CLOSE_WRITE,
+            Created = IN_CREATE,
+            Deleted = IN_DELETE,
+            DeletedSelf = IN_DELETE_SELF,
+            Modified = IN_MODIFY,
+            MovedSelf = IN_MOVE_SELF,
+            MovedFrom = IN_MOVED_FROM,
+            MovedTo = IN_MOVED_TO,
+
+            // Only reported
+
+            Ignored = IN_IGNORED,
+            IsDirectory = IN_ISDIR,
+            Overflow = IN_Q_OVERFLOW,
+
+            // Only given when adding a watch
+
+            OnlyDirectory = IN_ONLYDIR,
+        };
+
+        // ### Constructors
+
+        Watcher() = default;
+
+        Watcher(int Flags)
+        {
+            int Result = inotify_init1(Flags);
+
+            if (Result < 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            _INode = Result;
+        }
+
+        Watcher(Watcher &&Other) noexcept : Descriptor(std::move(Other)) {}
+        Watcher(Watcher const &Other) = delete;
+
+        // ### Functionalities
+
+        /**
+         * @brief Watches a path, watching the same path again returns the same descriptor
+         * @return Watch descriptor reported with the events of the path
+         */
+        int Add(std::string const &Path, uint32_t Events) const
+        {
+            int Result = inotify_add_watch(_INode, Path.c_str(), Events);
+
+            if (Result < 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            return Result;
+        }
+
+        void Remove(int Watch) const
+        {
+            if (inotify_rm_watch(_INode, Watch) < 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+        }
+
+        /**
+         * @brief Reads the pending events and calls Callback(inotify_event const &) for each
+         * Needs a non blocking instance
+         * @return Number of events read
+         */
+        template <typename TCallback>
+        size_t Listen(TCallback &&Callback) const
+        {
+            alignas(struct inotify_event) char Buffer[4096];
+            size_t Count = 0;
+
+            while (true)
+            {
+                ssize_t Result = read(_INode, Buffer, sizeof(Buffer));
+
+                if (Result < 0)
+                {
+                    if (errno == EAGAIN)
+                        return Count;
+
+                    throw std::system_error(errno, std::generic_category());
+                }
+
+                for (char *Cursor = Buffer; Cursor < Buffer + Result;)
+                {
+                    auto const *Item = reinterpret_cast<struct inotify_event const *>(Cursor);
+
+                    Callback(*Item);
+
+                    Cursor += sizeof(struct inotify_event) + Item->len;
+                    Count++;
+                }
+            }
+        }
+
+        Watcher &operator=(Watcher const &Other) = delete;
+
+        Watcher &operator=(Watcher &&Other) noexcept
+        {
+            Descriptor::operator=(std::move(Other));
+
+            return *this;
+        }
+    };
+}
@@ -0,0 +1,477 @@
+#pragma once
+
+#include <csignal>
+#include <cstring>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <system_error>
+
+#include "ePoll.hpp"
+#include "Iterable/List.hpp"
+#include "Descriptor.hpp"
+
+namespace Core
+{
+    /**
+     * @brief io_uring poll backend with the same interface as ePoll
+     * Registrations are poll requests that are queued in the submission ring
+     * and handed to the kernel together with the wait, so a loop iteration
+     * costs a single io_uring_enter no matter how many descriptors were added,
+     * modified or removed in it.
+     * Level triggered registrations are one-shot polls re-armed on the next wait,
+     * EdgeTriggered registrations are multishot polls.
+     * Only readiness goes through the ring, handlers still accept, read and
+     * write with their own syscalls. The saving is the batched registrations,
+     * which edge triggered connections mostly avoid on epoll as well.
+     */
+    class uRing : public Descriptor
+    {
+    public:
+        using Event = ePoll::Event;
+        using Entry = ePoll::Entry;
+        using List = ePoll::List;
+
+        static constexpr unsigned DefaultDepth = 1024;
+
+        // ### Constructors
+
+        uRing() = default;
+
+        uRing(uRing const &) = delete;
+        uRing(uRing &&Other) noexcept
+            : Descriptor(std::move(Other)),
+              _SQ(std::exchange(Other._SQ, {})),
+              _CQ(std::exchange(Other._CQ, {})),
+              _SQEs(std::exchange(Other._SQEs, nullptr)),
+              _SQEsSize(std::exchange(Other._SQEsSize, 0)),
+              _Unsubmitted(std::exchange(Other._Unsubmitted, 0)),
+              _Registrations(std::move(Other._Registrations)),
+              _Rearm(std::move(Other._Rearm)) {}
+
+        uRing(int Flags, unsigned Depth = DefaultDepth)
+        {
+            io_uring_params Params;
+            memset(&Params, 0, sizeof Params);
+
+            Params.flags = Flags;
+
+            int Result = syscall(__NR_io_uring_setup, Depth, &Params);
+
+            if (Result < 0)
+            {
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            _INode = Result;
+
+            Map(Params);
+        }
+
+        ~uRing()
+        {
+            Unmap();
+        }
+
+        // ### Functionalities
+
+        void Add(const Descriptor &descriptor, uint32_t Events, uint64_t Data)
+        {
+            auto &Item = At(descriptor.INode());
+
+            Item.Data = Data;
+            Item.Events = Events;
+            Item.Generation++;
+            Item.Active = true;
+
+            Arm(descriptor.INode(), Item);
+        }
+
+        void Add(const Descriptor &descriptor, uint32_t Events)
+        {
+            Add(descriptor, Events, static_cast<uint64_t>(descriptor.INode()));
+        }
+
+        void Modify(const Descriptor &descriptor, uint32_t Events, uint64_t Data)
+        {
+            auto &Item = At(descriptor.INode());
+
+            Cancel(descriptor.INode(), Item);
+
+            Item.Data = Data;
+            Item.Events = Events;
+            Item.Active = true;
+
+            Arm(descriptor.INode(), Item);
+        }
+
+        void Modify(const Descriptor &descriptor, uint32_t Events)
+        {
+            Modify(descriptor, Events, static_cast<uint64_t>(descriptor.INode()));
+        }
+
+        void Delete(const Descriptor &descriptor)
+        {
+            int INode = descriptor.INode();
+
+            if (INode < 0 || static_cast<size_t>(INode) >= _Registrations.Length() || !_Registrations[INode].Active)
+            {
+                throw std::system_error(ENOENT, std::generic_category());
+            }
+
+            auto &Item = _Registrations[INode];
+
+            Cancel(INode, Item);
+
+            Item.Active = false;
+        }
+
+        /**
+         * @brief Submits queued requests and waits for readiness events
+         * @param Timeout Milliseconds to wait, -1 blocks until an event arrives
+         */
+        void operator()(List &Items, int Timeout = -1)
+        {
+            // Level triggered polls that fired last round are armed again
+
+            for (size_t i = 0; i < _Rearm.Length(); i++)
+            {
+                auto &Item = _Registrations[_Rearm[i].INode];
+
+                if (Item.Active && !Item.Armed && Item.Generation == _Rearm[i].Generation)
+                    Arm(_Rearm[i].INode, Item);
+            }
+
+            _Rearm.Free();
+
+            if (IsReady())
+            {
+                Timeout = 0;
+            }
+
+            Enter(Timeout ? 1 : 0, Timeout);
+
+            Harvest(Items);
+        }
+
+        /**
+         * @brief Hands queued requests to the kernel without waiting
+         */
+        void Submit()
+        {
+            Enter(0, 0);
+        }
+
+        uRing &operator=(uRing const &Other) = delete;
+
+        uRing &operator=(uRing &&Other) noexcept
+        {
+            if (this != &Other)
+            {
+                Unmap();
+
+                Descriptor::operator=(std::move(Other));
+
+                _SQ = std::exchange(Other._SQ, {});
+                _CQ = std::exchange(Other._CQ, {});
+                _SQEs = std::exchange(Other._SQEs, nullptr);
+                _SQEsSize = std::exchange(Other._SQEsSize, 0);
+                _Unsubmitted = std::exchange(Other._Unsubmitted, 0);
+                _Registrations = std::move(Other._Registrations);
+                _Rearm = std::move(Other._Rearm);
+            }
+
+            return *this;
+        }
+
+    private:
+        // Poll requests use (INode << 32 | Generation) as user data so completions
+        // of a replaced or removed registration can be told apart
+
+        static constexpr uint64_t Ignored = ~0ull;
+        static constexpr uint32_t ModeMask = ePoll::EdgeTriggered | ePoll::OneShot;
+
+        struct Registration
+        {
+            uint64_t Data = 0;
+            uint32_t Events = 0;
+            uint32_t Generation = 0;
+            bool Active = false;
+            bool Armed = false;
+        };
+
+        struct Pending
+        {
+            int INode;
+            uint32_t Generation;
+        };
+
+        struct Ring
+        {
+            void *Pointer = nullptr;
+            size_t Size = 0;
+            unsigned *Head = nullptr;
+            unsigned *Tail = nullptr;
+            unsigned *Mask = nullptr;
+            unsigned *Entries = nullptr;
+            unsigned *Array = nullptr;
+            io_uring_cqe *CQEs = nullptr;
+        };
+
+        Ring _SQ;
+        Ring _CQ;
+        io_uring_sqe *_SQEs = nullptr;
+        size_t _SQEsSize = 0;
+        unsigned _Unsubmitted = 0;
+
+        Iterable::List<Registration> _Registrations;
+        Iterable::List<Pending> _Rearm;
+
+        void Map(io_uring_params const &Params)
+        {
+            _SQ.Size = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+            _CQ.Size = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+            bool Single = Params.features & IORING_FEAT_SINGLE_MMAP;
+
+            if (Single)
+                _SQ.Size = _CQ.Size = std::max(_SQ.Size, _CQ.Size);
+
+            _SQ.Pointer = mmap(nullptr, _SQ.Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _INode, IORING_OFF_SQ_RING);
+
+            if (_SQ.Pointer == MAP_FAILED)
+            {
+                _SQ.Pointer = nullptr;
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            if (Single)
+            {
+                _CQ.Pointer = _SQ.Pointer;
+            }
+            else
+            {
+                _CQ.Pointer = mmap(nullptr, _CQ.Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _INode, IORING_OFF_CQ_RING);
+
+                if (_CQ.Pointer == MAP_FAILED)
+                {
+                    _CQ.Pointer = nullptr;
+                    throw std::system_error(errno, std::generic_category());
+                }
+            }
+
+            _SQEsSize = Params.sq_entries * sizeof(io_uring_sqe);
+            _SQEs = static_cast<io_uring_sqe *>(mmap(nullptr, _SQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _INode, IORING_OFF_SQES));
+
+            if (_SQEs == MAP_FAILED)
+            {
+                _SQEs = nullptr;
+                throw std::system_error(errno, std::generic_category());
+            }
+
+            auto SQBase = static_cast<char *>(_SQ.Pointer);
+
+            _SQ.Head = reinterpret_cast<unsigned *>(SQBase + Params.sq_off.head);
+            _SQ.Tail = reinterpret_cast<unsigned *>(SQBase + Params.sq_off.tail);
+            _SQ.Mask = reinterpret_cast<unsigned *>(SQBase + Params.sq_off.ring_mask);
+            _SQ.Entries = reinterpret_cast<unsigned *>(SQBase + Params.sq_off.ring_entries);
+            _SQ.Array = reinterpret_cast<unsigned *>(SQBase + Params.sq_off.array);
+
+            auto CQBase = static_cast<char *>(_CQ.Pointer);
+
+            _CQ.Head = reinterpret_cast<unsigned *>(CQBase + Params.cq_off.head);
+            _CQ.Tail = reinterpret_cast<unsigned *>(CQBase + Params.cq_off.tail);
+            _CQ.Mask = reinterpret_cast<unsigned *>(CQBase + Params.cq_off.ring_mask);
+            _CQ.Entries = reinterpret_cast<unsigned *>(CQBase + Params.cq_off.ring_entries);
+            _CQ.CQEs = reinterpret_cast<io_uring_cqe *>(CQBase + Params.cq_off.cqes);
+        }
+
+        void Unmap()
+        {
+            if (_SQEs)
+                munmap(_SQEs, _SQEsSize);
+
+            if (_CQ.Pointer && _CQ.Pointer != _SQ.Pointer)
+                munmap(_CQ.Pointer, _CQ.Size);
+
+            if (_SQ.Pointer)
+                munmap(_SQ.Pointer, _SQ.Size);
+
+            _SQEs = nullptr;
+            _SQ = {};
+            _CQ = {};
+        }
+
+        Registration &At(int INode)
+        {
+            if (INode < 0)
+            {
+                throw std::system_error(EBADF, std::generic_category());
+            }
+
+            while (_Registrations.Length() <= static_cast<size_t>(INode))
+                _Registrations.Add();
+
+            return _Registrations[INode];
+        }
+
+        inline bool IsReady() const
+        {
+            return std::atomic_ref<unsigned>(*_CQ.Tail).load(std::memory_order_acquire) != *_CQ.Head;
+        }
+
+        io_uring_sqe &Next()
+        {
+            unsigned Tail = *_SQ.Tail;
+
+            // Ring is full, hand what we have to the kernel first
+
+            if (Tail - std::atomic_ref<unsigned>(*_SQ.Head).load(std::memory_order_acquire) >= *_SQ.Entries)
+            {
+                Submit();
+                Tail = *_SQ.Tail;
+            }
+
+            unsigned Index = Tail & *_SQ.Mask;
+            auto &SQE = _SQEs[Index];
+
+            memset(&SQE, 0, sizeof SQE);
+
+            _SQ.Array[Index] = Index;
+            std::atomic_ref<unsigned>(*_SQ.Tail).store(Tail + 1, std::memory_order_release);
+            _Unsubmitted++;
+
+            return SQE;
+        }
+
+        void Arm(int INode, Registration &Item)
+        {
+            auto &SQE = Next();
+
+            SQE.opcode = IORING_OP_POLL_ADD;
+            SQE.fd = INode;
+            SQE.poll32_events = Item.Events & ~ModeMask;
+            SQE.user_data = (static_cast<uint64_t>(INode) << 32) | Item.Generation;
+
+            if (Item.Events & ePoll::EdgeTriggered)
+                SQE.len = IORING_POLL_ADD_MULTI;
+
+            Item.Armed = true;
+        }
+
+        void Cancel(int INode, Registration &Item)
+        {
+            if (Item.Armed)
+            {
+                auto &SQE = Next();
+
+                SQE.opcode = IORING_OP_POLL_REMOVE;
+                SQE.fd = -1;
+                SQE.addr = (static_cast<uint64_t>(INode) << 32) | Item.Generation;
+                SQE.user_data = Ignored;
+            }
+
+            Item.Generation++;
+            Item.Armed = false;
+        }
+
+        void Enter(unsigned Wait, int Timeout)
+        {
+            unsigned Flags = Wait ? IORING_ENTER_GETEVENTS : 0;
+            void *Argument = nullptr;
+            size_t ArgumentSize = 0;
+
+            __kernel_timespec Time;
+            io_uring_getevents_arg Extended;
+
+            if (Wait && Timeout > 0)
+            {
+                Time.tv_sec = Timeout / 1000;
+                Time.tv_nsec = (Timeout % 1000) * 1000000;
+
+                memset(&Extended, 0, sizeof Extended);
+                Extended.sigmask_sz = _NSIG / 8;
+                Extended.ts = reinterpret_cast<uint64_t>(&Time);
+
+                Flags |= IORING_ENTER_EXT_ARG;
+                Argument = &Extended;
+                ArgumentSize = sizeof Extended;
+            }
+
+            if (!Wait && !_Unsubmitted)
+                return;
+
+            int Result = 0;
+            int Saved = 0;
+
+            do
+            {
+                Result = syscall(__NR_io_uring_enter, _INode, _Unsubmitted, Wait, Flags, Argument, ArgumentSize);
+                Saved = errno;
+
+                if (Result > 0)
+                    _Unsubmitted -= std::min<unsigned>(Result, _Unsubmitted);
+
+            } while (Result < 0 && Saved == EINTR);
+
+            // Timing out and a full completion ring are not failures
+
+            if (Result < 0 && Saved != ETIME && Saved != EBUSY && Saved != EAGAIN)
+            {
+                throw std::system_error(Saved, std::generic_category());
+            }
+        }
+
+        void Harvest(List &Items)
+        {
+            unsigned Head = *_CQ.Head;
+            unsigned Tail = std::atomic_ref<unsigned>(*_CQ.Tail).load(std::memory_order_acquire);
+            size_t Count = 0;
+
+            for (; Head != Tail && Count < Items.Capacity(); Head++)
+            {
+                auto &CQE = _CQ.CQEs[Head & *_CQ.Mask];
+
+                if (CQE.user_data == Ignored)
+                    continue;
+
+                int INode = static_cast<int>(CQE.user_data >> 32);
+                uint32_t Generation = static_cast<uint32_t>(CQE.user_data);
+
+                auto &Item = _Registrations[INode];
+
+                // Stale completion of a modified or removed registration
+
+                if (!Item.Active || Item.Generation != Generation)
+                    continue;
+
+                if (!(CQE.flags & IORING_CQE_F_MORE))
+                {
+                    Item.Armed = false;
+
+                    if (!(Item.Events & ePoll::OneShot))
+                        _Rearm.Add(Pending{INode, Generation});
+                }
+
+                if (CQE.res < 0)
+                {
+                    if (CQE.res == -ECANCELED)
+                        continue;
+
+                    Items.Content()[Count++] = Entry::From(Item.Data, ePoll::Error);
+                    continue;
+                }
+
+                Items.Content()[Count++] = Entry::From(Item.Data, static_cast<uint32_t>(CQE.res));
+            }
+
+            std::atomic_ref<unsigned>(*_CQ.Head).store(Head, std::memory_order_release);
+
+            Items.Length(Count);
+        }
+    };
+}
@@ -4,6 +4,7 @@
 #include <set>
 
 #include <Network/HTTP/Modules/Router.hpp>
+#include <Network/HTTP/Modules/Static.hpp>
 #include <Network/HTTP/Server.hpp>
 #include <Format/Stream.hpp>
 #include <File.hpp>
@@ -15,7 +16,7 @@ int main(int, char const *[])
 {
     // Create an instance of http runner with a 2 working threads
 
-    HTTP::Server<HTTP::Modules::Router> Server(2);
+    HTTP::Server<HTTP::Modules::Router, HTTP::Modules::Static> Server(2);
 
     Test::Log("Server started");
 
@@ -29,25 +30,24 @@ int main(int, char const *[])
             return HTTP::Response::HTML(Request.Version, HTTP::Status::NotFound, "<h1>404 Not Found</h1>");
         });
 
-    // Global Filter will be called if no route is matched and before Default is called
-    // This is an extremely simple static file filter
+    // Files under ./Public are served on /Public, each loop caches them and
+    // answers conditional and range requests
 
-    Server.Filter(
-        [SendFileThreshold = static_cast<size_t>(1024 * 100)](HTTP::Connection::Context &Context, HTTP::Request &Request, auto &&Next)
-        {
-            auto FileName = Request.Path.substr(1);
-
-            if (File::IsRegular(FileName))
-            {
-                auto StaticFile = File::Open(FileName, File::Binary | File::ReadOnly);
+    Server.Serve<"/Public">("Public");
 
-                if (!Context.CanUseSendFile() || StaticFile.Size() <= SendFileThreshold)
-                    Context.SendResponse(
-                        HTTP::Response::Type(Request.Version, HTTP::Status::OK, HTTP::GetContentType(File::GetExtension(FileName)), StaticFile.ReadAll()));
+    // Middlewares composed at compile time, the whole chain inlines into the request path
 
-                Context.SendResponse(
-                    HTTP::Response::Type(Request.Version, HTTP::Status::OK, HTTP::GetContentType(File::GetExtension(FileName))),
-                    std::move(StaticFile));
+    Server.Pipeline(
+        [](HTTP::Connection::Context &Context, HTTP::Request &Request, auto &&Next)
+        {
+            Next(Context, Request);
+        },
+        [](HTTP::Connection::Context &Context, HTTP::Request &Request, auto &&Next)
+        {
+            if (Request.View.Method == HTTP::Methods::Any)
+            {
+                Context.SendResponse(HTTP::Response::From(Request.View.Version, HTTP::Status::MethodNotAllowed));
+                return;
             }
 
             Next(Context, Request);
@@ -90,6 +90,30 @@ int main(int, char const *[])
                 });
         });
 
+    // Route which streams a large body, it is generated only as fast as the client reads it
+
+    Server.GET<"/Count">(
+        [](HTTP::Connection::Context &Context, HTTP::Request &Request)
+        {
+            auto Counter = std::make_shared<size_t>(0);
+
+            auto Write = [Context, Counter]
+            {
+                while (*Counter < 1000000)
+                {
+                    if (!Context.SendChunk(std::to_string((*Counter)++) + "\n"))
+                        return;
+                }
+
+                Context.EndStream();
+            };
+
+            Context.StreamResponse(HTTP::Response::Type(Request.Version, HTTP::Status::OK, "text/plain", ""));
+            Context.OnWritable(Write);
+
+            Write();
+        });
+
     // Route which watches for connections to disconnect after visiting this route
 
     Server.GET<"/Notify">(
@@ -158,7 +182,7 @@ int main(int, char const *[])
     Server.GET<"/Source">(
         [](HTTP::Connection::Context &Context, HTTP::Request &Request)
         {
-            Context.SendResponse(HTTP::Response::HTML(Request.Version, HTTP::Status::OK, Context.Source.ToString() + (Context.IsSecure() ? " Is secure" : " Isn't secure")));
+            Context.SendResponse(HTTP::Response::HTML(Request.Version, HTTP::Status::OK, Context.Source.ToString() + (Context.IsSecure() ? " Is secure" : " Isn't secure") + (Context.HasKTLS() ? " with kernel TLS" : "")));
         });
 
     // Init thread storages and other settings
@@ -191,6 +215,12 @@ int main(int, char const *[])
 
         .Listen({"0.0.0.0:8888"})
 
+        // Session resumption of HTTPS listeners added after it, tickets are
+        // sealed with a new key every hour and sessions are cached for two
+
+        .SessionTickets(true, {3600, 0})
+        .SessionCache(1024 * 20, {7200, 0})
+
         // HTTPS Listener
 
         .Listen({"0.0.0.0:4444"}, "Cert.pem", "Key.pem")